@@ -0,0 +1,564 @@
+/*
+ * bench.cpp:
+ *
+ * Host-side benchmark of the serial passthrough (SerialPass) and the runner
+ * scheduler (Runner::cycle), built against the simulator. Each workload is a
+ * host byte stream: matrix write frames, matrix read frames answered by a
+ * simulated matrix, <KEYmsg> control frames, the same updates as binary
+ * frames, a mix of them, and optionally a
+ * recorded host capture given on the command line. Each workload reports:
+ *
+ * 1. Per-byte cost: host CPU time SerialPass spends per byte, in its receiver
+ *    and run, with the serial ports saturated so every loop has a byte. This
+ *    is measured with the table-driven deframer, and with the chain of
+ *    comparisons it replaced in the receiver.
+ * 2. Throughput: host bytes per second taken in by the switch at each baud,
+ *    against the wire limit of baud/10, and bytes dropped on the way. The
+ *    matrix link runs at the baud clamped to MATRIX_MAX_BAUD, as on the
+ *    board, and its rate is printed as "matrix".
+ * 3. Latency: time from the end of a matrix frame arriving from the host to
+ *    the end of it leaving for the matrix. Reads are paced, each sent once the
+ *    reply to the last is back, as a polling host would; their latency runs
+ *    to the end of the reply reaching the host, whether the matrix or the
+ *    switch's model answered it. Each scenario runs until the matrix wire has
+ *    drained, so its last frame is counted.
+ * 4. Jitter: deviation of the time between Runner::cycle dispatches from the
+ *    runner's period, with runners standing in for the firmware's runners at
+ *    their periods and typical run costs.
+ *
+ * Usage: bench [capture file]
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "hal.hpp"
+#include "types.hpp"
+#include "runner.hpp"
+#include "serial.hpp"
+//!< Repeats of each synthetic frame in a workload
+#define BENCH_FRAMES 200
+//!< Virtual time limit of each scenario
+#define BENCH_TIMEOUT_MS 120000
+//!< Bytes per saturated chunk, fits the receive buffer
+#define BENCH_CHUNK 48
+//!< Read frame and the response the simulated matrix gives
+#define BENCH_READ "MT00RD0000NT"
+#define BENCH_RESPONSE "MT00RD0101020203030404050506060707080809091010NT"
+
+//!< Runs of each per-byte cost measurement, the fastest taken
+#define BENCH_COST_RUNS 5
+
+//!< Baud rates benchmarked
+static const unsigned long BAUDS[] = {9600, 57600, 115200};
+//!< Errors reported by the firmware during the run
+static unsigned long s_errors = 0;
+
+/**
+ * Errors are counted, not displayed
+ */
+void error(const char* file, const int line, const char* message) {
+    (void) file;
+    (void) line;
+    (void) message;
+    s_errors++;
+}
+/**
+ * Stand-in runner: burns its run cost on the virtual clock, and records how
+ * far each dispatch interval strays from its period.
+ */
+class BenchRunner : public Runner {
+    public:
+        BenchRunner(const char* name, uint16_t period, uint16_t phase, uint32_t cost) :
+            Runner(period, phase),
+            m_name(name),
+            m_cost(cost)
+        {
+            clear();
+        }
+        void run() {
+            uint32_t now = micros();
+            if (m_runs > 0) {
+                uint32_t interval = now - m_previous;
+                uint32_t period = static_cast<uint32_t>(m_period) * 1000;
+                uint32_t jitter = (interval > period) ? (interval - period) : (period - interval);
+                m_jitter_total += jitter;
+                m_jitter_worst = (jitter > m_jitter_worst) ? jitter : m_jitter_worst;
+            }
+            m_previous = now;
+            m_runs++;
+            delayMicroseconds(m_cost);
+        }
+        void clear() {
+            m_jitter_total = 0;
+            m_jitter_worst = 0;
+            m_runs = 0;
+        }
+        //!< Name printed in reports
+        const char* m_name;
+        //!< Virtual cost of each run in microseconds
+        uint32_t m_cost;
+        //!< Jitter sum and worst, in microseconds
+        uint64_t m_jitter_total;
+        uint32_t m_jitter_worst;
+        //!< Previous dispatch time
+        uint32_t m_previous;
+        //!< Dispatch count
+        uint32_t m_runs;
+};
+//Periods match the firmware, costs are rough figures for the Nano. The OLED
+//cost is rendering one page's columns, as while drawing a frame. Sending it
+//is left to the TWI interrupt.
+BenchRunner r_button("button", 10, 0, 20);
+BenchRunner r_rgb("rgb", 20, 3, 300);
+BenchRunner r_led("led13", 100, 7, 20);
+BenchRunner r_oled("oled", 20, 13, 400);
+Runner* runners[] = {&r_button, &r_rgb, &r_led, &r_oled};
+BenchRunner* bench_runners[] = {&r_button, &r_rgb, &r_led, &r_oled};
+
+/**
+ * A workload: a name, its host byte stream, and whether its frames are paced,
+ * each sent once the reply to the last is back, as a host polling would
+ */
+struct Workload {
+    std::string name;
+    std::string stream;
+    bool paced;
+};
+/**
+ * A matrix frame found in a stream: its bytes and where it ends
+ */
+struct Frame {
+    std::string bytes;
+    size_t end;
+};
+/**
+ * Split matrix frames, 'M' through the second 'T', out of a byte stream.
+ * Control frames, binary frames, and stray bytes are skipped.
+ */
+static std::vector<Frame> frames(const std::string& stream) {
+    std::vector<Frame> found;
+    std::string current;
+    bool control = false;
+    int tees = 0;
+    for (size_t i = 0; i < stream.size(); i++) {
+        char byte = stream[i];
+        if (current.empty() && !control && byte == BINARY_START && (i + 1) < stream.size()) {
+            i += static_cast<uint8_t>(stream[i + 1]) + BINARY_OVERHEAD - 1;
+        } else if (current.empty() && !control) {
+            control = (byte == START_CMD);
+            if (byte == 'M') {
+                current.push_back(byte);
+                tees = 0;
+            }
+        } else if (control) {
+            control = (byte != END_CMD);
+        } else {
+            current.push_back(byte);
+            tees += (byte == 'T') ? 1 : 0;
+            if (tees == 2) {
+                Frame frame = {current, i};
+                found.push_back(frame);
+                current.clear();
+            }
+        }
+    }
+    return found;
+}
+/**
+ * Simulated matrix: answers each read frame with a response as soon as the
+ * frame has left the wire, as the real matrix would
+ */
+class Matrix {
+    public:
+        Matrix(SimSerial& serial) : m_serial(serial), m_reads(0) {
+            s_matrix = this;
+            m_serial.set_sink(Matrix::sink);
+        }
+        ~Matrix() {
+            m_serial.set_sink(NULL);
+            s_matrix = NULL;
+        }
+        /**
+         * Take a byte off the wire. Records frames seen, with end times.
+         */
+        void take(uint8_t byte, uint64_t time) {
+            if (m_frame.empty() && byte != 'M') {
+                return;
+            }
+            m_frame.push_back(static_cast<char>(byte));
+            if (byte == 'T' && m_frame.size() > 2 &&
+                m_frame.find('T') != (m_frame.size() - 1)) {
+                m_seen.push_back(m_frame);
+                m_times.push_back(time);
+                if (m_frame.find("RD") != std::string::npos) {
+                    m_serial.inject(reinterpret_cast<const uint8_t*>(BENCH_RESPONSE),
+                                    strlen(BENCH_RESPONSE));
+                    m_reads++;
+                }
+                m_frame.clear();
+            }
+        }
+        static void sink(uint8_t byte, uint64_t time) {
+            s_matrix->take(byte, time);
+        }
+        //!< Matrix side of the link
+        SimSerial& m_serial;
+        //!< Partial frame
+        std::string m_frame;
+        //!< Frames seen, and the time each finished arriving
+        std::vector<std::string> m_seen;
+        std::vector<uint64_t> m_times;
+        //!< Reads answered
+        unsigned long m_reads;
+        //!< Matrix taking bytes from the sink
+        static Matrix* s_matrix;
+};
+Matrix* Matrix::s_matrix = NULL;
+
+/**
+ * Binary frame of records, each a header, key, and value
+ */
+static std::string binary(uint8_t sequence, const std::string& records) {
+    std::string frame;
+    frame.push_back(static_cast<char>(BINARY_START));
+    frame.push_back(static_cast<char>(records.size()));
+    frame.push_back(static_cast<char>(sequence));
+    frame += records;
+    uint16_t crc = BINARY_CRC_INIT;
+    for (size_t i = 1; i < frame.size(); i++) {
+        crc ^= static_cast<uint16_t>(static_cast<uint8_t>(frame[i])) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ BINARY_CRC_POLY) : (crc << 1);
+        }
+    }
+    frame.push_back(static_cast<char>(crc >> 8));
+    frame.push_back(static_cast<char>(crc));
+    return frame;
+}
+/**
+ * Build the synthetic workloads
+ */
+static std::vector<Workload> workloads() {
+    std::vector<Workload> list;
+    Workload matrix = {"matrix", "", false};
+    Workload control = {"control", "", false};
+    Workload packed = {"binary", "", false};
+    Workload read = {"read", "", true};
+    Workload mixed = {"mixed", "", false};
+    //The control workload's two updates, in one binary frame
+    std::string records;
+    records.push_back(static_cast<char>((BINARY_OP_ADDRESS << BINARY_OP_SHIFT) | 4));
+    records += std::string("IP\0\0\x0A\0\0\x01", 8);
+    records.push_back(static_cast<char>((BINARY_OP_TEXT << BINARY_OP_SHIFT) | 10));
+    records += "ROOMBallroom A";
+    char frame[MATRIX_TEMPLATE_SIZE + 1];
+    for (unsigned int i = 0; i < BENCH_FRAMES; i++) {
+        snprintf(frame, sizeof(frame), "MT00SW%02u02NT", (i % MATRIX_INPUTS) + 1);
+        matrix.stream += frame;
+        control.stream += (i % 2 == 0) ? "<IP  10.0.0.1>" : "<ROOMBallroom A>";
+        packed.stream += (i % 2 == 0) ? binary(static_cast<uint8_t>(i), records) : "";
+        read.stream += BENCH_READ;
+        switch (i % 4) {
+            case 0: mixed.stream += frame; break;
+            case 1: mixed.stream += "<IP  10.0.0.1>"; break;
+            case 2: mixed.stream += BENCH_READ; break;
+            default: mixed.stream += "<ROOMBallroom A>"; mixed.stream += frame; break;
+        }
+    }
+    list.push_back(matrix);
+    list.push_back(control);
+    list.push_back(packed);
+    list.push_back(read);
+    list.push_back(mixed);
+    return list;
+}
+/**
+ * ChainDeframer:
+ *
+ * The deframer's grammar as a chain of comparisons, as it was before its
+ * tables, over the same hooks and state of SerialPass, to compare against.
+ */
+class ChainDeframer {
+    public:
+        /**
+         * Deframe one host byte as SerialPass::deframe.
+         * \param SerialPass& pass: passthrough deframing
+         * \param uint8_t byte: host byte
+         * \return true if taken, false to leave it buffered for later
+         */
+        static bool deframe(SerialPass& pass, uint8_t byte);
+};
+bool ChainDeframer::deframe(SerialPass& pass, uint8_t byte) {
+    char character = static_cast<char>(byte);
+    //Handle operations in normal mode (sending matrix data)
+    if (pass.m_state == IDLE) {
+        //Read a start character, switch to command mode, once the last
+        //command's data has been parsed
+        if (character == START_CMD) {
+            if (pass.m_command) {
+                return false;
+            }
+            pass.m_state = COMMAND;
+            pass.m_cmd_index = 0;
+        }
+        //Binary frame start, likewise once the last command's data is parsed
+        else if (byte == BINARY_START) {
+            if (pass.m_command) {
+                return false;
+            }
+            pass.m_state = BINARY;
+            pass.m_frame_index = 0;
+            pass.m_binary_progress = pass.m_binary_progress + 1;
+        }
+        //Handle 'M' characters the other possible token
+        else if (character == MATRIX_START) {
+            pass.open();
+            pass.m_state = MSG1;
+        }
+    }
+    // Messaging states
+    else if (pass.m_state == MSG1 || pass.m_state == MSG2) {
+        SerialState next = pass.m_state;
+        if (character == MATRIX_PART_END) {
+            next = (pass.m_state == MSG1) ? MSG2 : IDLE;
+        }
+        return pass.relay(byte, next);
+    }
+    else if (pass.m_state == BINARY) {
+        pass.take(byte);
+    }
+    //Command mode, read data and store for parsing
+    else if (pass.m_state == COMMAND) {
+        //Termination of command mode, hand stored data to the main loop
+        if (character == END_CMD) {
+            pass.m_state = IDLE;
+            pass.m_command = true;
+        }
+        //A new start cuts the unterminated command short
+        else if (character == START_CMD) {
+            pass.m_cmd_index = 0;
+            pass.m_resyncs++;
+        }
+        else {
+            pass.capture(byte);
+        }
+    }
+    return true;
+}
+/**
+ * Receiver deframing with the chain of comparisons
+ */
+static bool chain_receive(uint8_t byte) {
+    return ChainDeframer::deframe(*SerialPass::s_instance, byte);
+}
+/**
+ * Per-byte host CPU cost of SerialPass: deframing in the receiver as bytes
+ * are injected, and run. Both ports run at no wire delay, and the clock read
+ * cost is set such that each window has about one loop per byte fed to it.
+ * Bytes the receiver leaves buffered are deframed by run from the tables
+ * either way; both deframers keep the same state.
+ */
+static double per_byte_ns(const Workload& workload, bool chain) {
+    SimSerial host(0, 1, false);
+    MatrixSerial wire(3, 6, false);
+    SerialPass pass(host, wire);
+    Matrix matrix(wire);
+    pass.begin(0);
+    if (chain) {
+        host.set_receiver(chain_receive);
+    }
+    Sim::set_read_cost(MS_PER_SECOND / (BENCH_CHUNK + 2));
+    std::chrono::nanoseconds spent(0);
+    const std::string& stream = workload.stream;
+    for (size_t i = 0; i < stream.size(); i += BENCH_CHUNK) {
+        size_t size = (stream.size() - i < BENCH_CHUNK) ? (stream.size() - i) : BENCH_CHUNK;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        host.inject(reinterpret_cast<const uint8_t*>(stream.data() + i), size);
+        pass.run(1);
+        spent += std::chrono::steady_clock::now() - begin;
+        uint8_t discard[SIM_SERIAL_BUFFER];
+        while (host.collect(discard, sizeof(discard)) > 0) {}
+    }
+    Sim::set_read_cost(SIM_READ_COST_US);
+    return static_cast<double>(spent.count()) / stream.size();
+}
+/**
+ * Put bytes on the host wire, returning the time they finish arriving when the
+ * wire was idle
+ */
+static uint64_t send(SimSerial& host, const std::string& bytes) {
+    host.inject(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+    return Sim::now() + static_cast<uint64_t>(bytes.size()) * host.byte_time();
+}
+/**
+ * Run a workload through the scheduler at a baud rate, and print its row
+ */
+static void scenario(const Workload& workload, unsigned long baud) {
+    SimSerial host(0, 1, false);
+    MatrixSerial wire(3, 6, false);
+    SerialPass pass(host, wire);
+    Matrix matrix(wire);
+    pass.begin(baud);
+    Runner::register_sleeper(&pass);
+    Runner::reset_telemetry();
+    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(bench_runners); i++) {
+        bench_runners[i]->clear();
+    }
+    //Expected frames and the time each finishes arriving. Paced frames are
+    //sent from the loop, unpaced ones all at once.
+    std::vector<Frame> expected = frames(workload.stream);
+    std::vector<uint64_t> arrivals;
+    uint64_t start = Sim::now();
+    if (!workload.paced) {
+        send(host, workload.stream);
+        for (size_t i = 0; i < expected.size(); i++) {
+            arrivals.push_back(start + static_cast<uint64_t>(expected[i].end + 1) * host.byte_time());
+        }
+    }
+    Runner::start();
+    //Run until all bytes are taken or dropped, all reads answered, and the
+    //matrix wire has drained
+    const std::vector<std::string>& seen = matrix.m_seen;
+    const std::vector<uint64_t>& times = matrix.m_times;
+    std::vector<uint64_t> replies;
+    size_t responses = 0;
+    uint8_t previous = 0;
+    uint32_t taken = 0;
+    uint64_t last = start;
+    while ((Sim::now() - start) < static_cast<uint64_t>(BENCH_TIMEOUT_MS) * 1000) {
+        if (workload.paced && replies.size() == arrivals.size() && arrivals.size() < expected.size()) {
+            arrivals.push_back(send(host, expected[arrivals.size()].bytes));
+        }
+        Runner::cycle();
+        uint8_t data[SIM_SERIAL_BUFFER];
+        uint64_t stamps[SIM_SERIAL_BUFFER];
+        size_t count;
+        while ((count = host.collect(data, stamps, sizeof(data))) > 0) {
+            responses += count;
+            for (size_t i = 0; i < count; i++) {
+                if (previous == 'N' && data[i] == 'T') {
+                    replies.push_back(stamps[i]);
+                }
+                previous = data[i];
+            }
+        }
+        if (host.m_received != taken) {
+            taken = host.m_received;
+            last = Sim::now();
+        }
+        bool consumed = (host.m_received + host.m_dropped) >= workload.stream.size();
+        bool answered = workload.paced ? (replies.size() >= expected.size()) :
+            (responses >= (matrix.m_reads * strlen(BENCH_RESPONSE)));
+        bool drained = wire.next_event() == UINT64_MAX;
+        if (consumed && answered && drained) {
+            break;
+        }
+    }
+    //Match paced frames to their replies, as the switch may answer reads
+    //itself, and other frames to the frames forwarded, in order
+    std::vector<uint64_t> latencies;
+    if (workload.paced) {
+        for (size_t i = 0; i < replies.size() && i < arrivals.size(); i++) {
+            latencies.push_back(replies[i] - arrivals[i]);
+        }
+    } else {
+        size_t next = 0;
+        for (size_t i = 0; i < seen.size(); i++) {
+            while (next < expected.size() && expected[next].bytes != seen[i]) {
+                next++;
+            }
+            if (next >= expected.size()) {
+                break;
+            }
+            latencies.push_back(times[i] - arrivals[next]);
+            next++;
+        }
+    }
+    uint64_t latency_total = 0;
+    uint64_t latency_worst = 0;
+    size_t matched = latencies.size();
+    for (size_t i = 0; i < latencies.size(); i++) {
+        latency_total += latencies[i];
+        latency_worst = (latencies[i] > latency_worst) ? latencies[i] : latency_worst;
+    }
+    double seconds = static_cast<double>(last - start) / 1000000.0;
+    double rate = (seconds > 0) ? (host.m_received / seconds) : 0.0;
+    uint64_t jitter_total = 0;
+    uint32_t jitter_worst = 0;
+    uint32_t runs = 0;
+    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(bench_runners); i++) {
+        jitter_total += bench_runners[i]->m_jitter_total;
+        runs += (bench_runners[i]->m_runs > 0) ? (bench_runners[i]->m_runs - 1) : 0;
+        jitter_worst = (bench_runners[i]->m_jitter_worst > jitter_worst) ?
+            bench_runners[i]->m_jitter_worst : jitter_worst;
+    }
+    unsigned long link = (baud > MATRIX_MAX_BAUD) ? MATRIX_MAX_BAUD : baud;
+    printf("%-9s %6lu %6lu %6lu %9.0f %5.0f%% %5lu/%-5lu %9.0f %9lu %9.0f %9u %9u %6lu\n",
+           workload.name.c_str(), baud, link, static_cast<unsigned long>(host.m_received), rate,
+           100.0 * rate / (baud / 10.0),
+           static_cast<unsigned long>(matched), static_cast<unsigned long>(expected.size()),
+           (matched == 0) ? 0.0 : static_cast<double>(latency_total) / matched,
+           static_cast<unsigned long>(latency_worst),
+           (runs == 0) ? 0.0 : static_cast<double>(jitter_total) / runs,
+           r_button.m_jitter_worst, jitter_worst,
+           static_cast<unsigned long>(host.m_dropped + wire.m_dropped));
+}
+/**
+ * Read a recorded host capture as a workload
+ */
+static bool recorded(const char* path, Workload& workload) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    workload.name = "recorded";
+    workload.paced = false;
+    int byte;
+    while ((byte = fgetc(file)) != EOF) {
+        workload.stream.push_back(static_cast<char>(byte));
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    std::vector<Workload> list = workloads();
+    if (argc > 1) {
+        Workload capture;
+        if (!recorded(argv[1], capture)) {
+            fprintf(stderr, "Cannot read capture %s\n", argv[1]);
+            return 1;
+        }
+        list.push_back(capture);
+    }
+    Runner::register_runners(runners, NUM_ARRAY_ELEMENTS(runners));
+    printf("Per-byte cost of SerialPass (host CPU), deframing by table and by chain\n");
+    for (size_t i = 0; i < list.size(); i++) {
+        double table = 0;
+        double chain = 0;
+        for (unsigned int run = 0; run < BENCH_COST_RUNS; run++) {
+            double cost = per_byte_ns(list[i], false);
+            table = (run == 0 || cost < table) ? cost : table;
+            cost = per_byte_ns(list[i], true);
+            chain = (run == 0 || cost < chain) ? cost : chain;
+        }
+        printf("%-9s %8.1f ns/byte %8.1f ns/byte\n", list[i].name.c_str(), table, chain);
+    }
+    printf("\nThroughput, forwarding latency (us), and Runner::cycle jitter (us)\n");
+    printf("%-9s %6s %6s %6s %9s %6s %11s %9s %9s %9s %9s %9s %6s\n",
+           "workload", "baud", "matrix", "bytes", "bytes/s", "wire", "frames", "lat avg",
+           "lat max", "jit avg", "btn max", "jit max", "drops");
+    for (size_t i = 0; i < list.size(); i++) {
+        for (unsigned int j = 0; j < NUM_ARRAY_ELEMENTS(BAUDS); j++) {
+            scenario(list[i], BAUDS[j]);
+        }
+    }
+    printf("\nErrors reported: %lu\n", s_errors);
+    return 0;
+}
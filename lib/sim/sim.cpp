@@ -0,0 +1,756 @@
+/*
+ * sim.cpp:
+ *
+ * Native simulator implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef ARDUINO
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+#include "sim.hpp"
+//!< Virtual run time of the native program, unless given
+#define SIM_RUN_MS 10000
+
+//!< Virtual time in microseconds
+static uint64_t s_now = 0;
+//!< Cost of each clock read
+static uint32_t s_read_cost = SIM_READ_COST_US;
+//!< Pin modes, written levels, PWM duty, and outside drives
+static uint8_t s_mode[SIM_PIN_COUNT];
+static uint8_t s_level[SIM_PIN_COUNT];
+static int s_pwm[SIM_PIN_COUNT];
+static bool s_driven[SIM_PIN_COUNT];
+static uint8_t s_drive_level[SIM_PIN_COUNT];
+//!< Attached interrupts, their modes, and pending edges
+static void (*s_isr[SIM_INTERRUPT_COUNT])(void);
+static int s_isr_mode[SIM_INTERRUPT_COUNT];
+static bool s_isr_pending[SIM_INTERRUPT_COUNT];
+static bool s_interrupts = true;
+//!< Pin change interrupts, and pending changes
+static void (*s_pcint[SIM_PIN_COUNT])(void);
+static bool s_pcint_pending[SIM_PIN_COUNT];
+//!< Timer interrupt, its period, next overflow, and pending overflow
+static void (*s_timer_isr)(void) = NULL;
+static uint32_t s_timer_period = 0;
+static uint64_t s_timer_next = UINT64_MAX;
+static bool s_timer_pending = false;
+//!< A timer interrupt is running, which may read the clock itself
+static bool s_in_timer = false;
+//!< I2C interrupt, bus clock, transmission on the bus and when it leaves it,
+//!< last status, and pending end of transmission
+static void (*s_i2c_isr)(void) = NULL;
+static uint32_t s_i2c_clock = 100000;
+static uint8_t s_i2c_address = 0;
+static uint8_t s_i2c_data[SIM_I2C_BUFFER];
+static size_t s_i2c_size = 0;
+static uint64_t s_i2c_done = UINT64_MAX;
+static uint8_t s_i2c_status = 0;
+static bool s_i2c_pending = false;
+//!< EEPROM contents, erased, writes of each byte, and when the last write
+//!< is done
+static uint8_t s_eeprom[E2END + 1];
+static uint32_t s_eeprom_writes[E2END + 1];
+static uint64_t s_eeprom_ready = 0;
+//!< File keeping the EEPROM between runs, if any
+static const char* s_eeprom_file = NULL;
+//!< Serial ports updated with the clock
+static SimSerial* s_serials[SIM_MAX_SERIAL];
+static unsigned int s_serial_count = 0;
+//!< End of the native program run
+static uint64_t s_stop = static_cast<uint64_t>(SIM_RUN_MS) * 1000;
+//!< Host bytes from stdin, injected once Serial is running
+static std::vector<uint8_t> s_stdin;
+
+SimSerial Serial(0, 1, false);
+SimPanel Panel;
+
+/**
+ * Every clock read costs a little time, such that busy loops move forward
+ */
+uint32_t millis() {
+    Sim::advance(s_read_cost);
+    return static_cast<uint32_t>(s_now / 1000);
+}
+uint32_t micros() {
+    Sim::advance(s_read_cost);
+    return static_cast<uint32_t>(s_now);
+}
+void delay(uint32_t ms) {
+    Sim::advance(ms * 1000);
+}
+void delayMicroseconds(unsigned int us) {
+    Sim::advance(us);
+}
+void pinMode(uint8_t pin, uint8_t mode) {
+    if (pin < SIM_PIN_COUNT) {
+        s_mode[pin] = mode;
+    }
+}
+void digitalWrite(uint8_t pin, uint8_t level) {
+    if (pin < SIM_PIN_COUNT) {
+        s_level[pin] = (level != LOW) ? HIGH : LOW;
+    }
+}
+/**
+ * Driven pins read their drive. Otherwise pull-ups read high and outputs read
+ * back their level.
+ */
+int digitalRead(uint8_t pin) {
+    if (pin >= SIM_PIN_COUNT) {
+        return LOW;
+    } else if (s_driven[pin]) {
+        return s_drive_level[pin];
+    } else if (s_mode[pin] == INPUT_PULLUP) {
+        return HIGH;
+    } else if (s_mode[pin] == OUTPUT) {
+        return s_level[pin];
+    }
+    return LOW;
+}
+void analogWrite(uint8_t pin, int value) {
+    if (pin < SIM_PIN_COUNT) {
+        s_pwm[pin] = value;
+        s_level[pin] = (value >= 0x80) ? HIGH : LOW;
+    }
+}
+/**
+ * Nano external interrupts: INT0 on pin 2, INT1 on pin 3
+ */
+int digitalPinToInterrupt(uint8_t pin) {
+    return (pin == 2) ? 0 : ((pin == 3) ? 1 : NOT_AN_INTERRUPT);
+}
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode) {
+    if (interrupt < SIM_INTERRUPT_COUNT) {
+        s_isr[interrupt] = isr;
+        s_isr_mode[interrupt] = mode;
+        s_isr_pending[interrupt] = false;
+    }
+}
+void detachInterrupt(uint8_t interrupt) {
+    if (interrupt < SIM_INTERRUPT_COUNT) {
+        s_isr[interrupt] = NULL;
+    }
+}
+void attachPinChange(uint8_t pin, void (*isr)(void)) {
+    if (pin < SIM_PIN_COUNT) {
+        s_pcint[pin] = isr;
+        s_pcint_pending[pin] = false;
+    }
+}
+void attachTimer(uint32_t period_us, void (*isr)(void)) {
+    s_timer_isr = isr;
+    s_timer_period = (period_us == 0) ? 1 : period_us;
+    s_timer_next = s_now + s_timer_period;
+    s_timer_pending = false;
+}
+void attachI2c(uint32_t clock, void (*isr)(void)) {
+    s_i2c_isr = isr;
+    s_i2c_clock = (clock == 0) ? 1 : clock;
+}
+/**
+ * Each byte, the address included, takes nine bit-times with its acknowledge
+ */
+void i2cTransmit(uint8_t address, const uint8_t* data, size_t size) {
+    size = (size < SIM_I2C_BUFFER) ? size : SIM_I2C_BUFFER;
+    s_i2c_address = address;
+    memcpy(s_i2c_data, data, size);
+    s_i2c_size = size;
+    s_i2c_done = s_now + ((size + 1) * 9 * 1000000ULL) / s_i2c_clock;
+}
+uint8_t i2cStatus() {
+    return s_i2c_status;
+}
+uint8_t eeprom_read_byte(const uint8_t* address) {
+    return s_eeprom[reinterpret_cast<uintptr_t>(address) & E2END];
+}
+/**
+ * As avr-libc, a write first waits out the last one
+ */
+void eeprom_write_byte(uint8_t* address, uint8_t value) {
+    if (s_now < s_eeprom_ready) {
+        Sim::advance(static_cast<uint32_t>(s_eeprom_ready - s_now));
+    }
+    uintptr_t index = reinterpret_cast<uintptr_t>(address) & E2END;
+    s_eeprom[index] = value;
+    s_eeprom_writes[index]++;
+    s_eeprom_ready = s_now + SIM_EEPROM_WRITE_US;
+}
+bool eeprom_is_ready() {
+    return s_now >= s_eeprom_ready;
+}
+void noInterrupts() {
+    s_interrupts = false;
+}
+/**
+ * Enabling interrupts delivers any edge seen while they were off
+ */
+void interrupts() {
+    s_interrupts = true;
+    for (unsigned int i = 0; i < SIM_INTERRUPT_COUNT; i++) {
+        if (s_isr_pending[i] && s_isr[i] != NULL) {
+            s_isr_pending[i] = false;
+            s_isr[i]();
+        }
+    }
+    for (unsigned int i = 0; i < SIM_PIN_COUNT; i++) {
+        if (s_pcint_pending[i] && s_pcint[i] != NULL) {
+            s_pcint_pending[i] = false;
+            s_pcint[i]();
+        }
+    }
+    //Timer interrupts do not nest, as on the board
+    if (s_timer_pending && s_timer_isr != NULL && !s_in_timer) {
+        s_timer_pending = false;
+        s_in_timer = true;
+        s_timer_isr();
+        s_in_timer = false;
+    }
+    if (s_i2c_pending && s_i2c_isr != NULL) {
+        s_i2c_pending = false;
+        s_i2c_isr();
+    }
+}
+
+/**
+ * Print bytes one at a time
+ */
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    for (size_t i = 0; i < size; i++) {
+        count += write(buffer[i]);
+    }
+    return count;
+}
+size_t Print::write(const char* buffer, size_t size) {
+    return write(reinterpret_cast<const uint8_t*>(buffer), size);
+}
+size_t Print::write(const char* str) {
+    return (str == NULL) ? 0 : write(str, strlen(str));
+}
+size_t Print::print(const char* str) {
+    return write(str);
+}
+size_t Print::print(char value) {
+    return write(static_cast<uint8_t>(value));
+}
+size_t Print::print(int value, int base) {
+    return print(static_cast<long>(value), base);
+}
+size_t Print::print(unsigned int value, int base) {
+    return print(static_cast<unsigned long>(value), base);
+}
+size_t Print::print(long value, int base) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), (base == HEX) ? "%lX" : "%ld", value);
+    return write(buffer);
+}
+size_t Print::print(unsigned long value, int base) {
+    char buffer[24];
+    snprintf(buffer, sizeof(buffer), (base == HEX) ? "%lX" : "%lu", value);
+    return write(buffer);
+}
+size_t Print::println() {
+    return write("\r\n");
+}
+size_t Print::println(const char* str) {
+    return print(str) + println();
+}
+size_t Print::println(char value) {
+    return print(value) + println();
+}
+size_t Print::println(int value, int base) {
+    return print(value, base) + println();
+}
+size_t Print::println(unsigned int value, int base) {
+    return print(value, base) + println();
+}
+size_t Print::println(long value, int base) {
+    return print(value, base) + println();
+}
+size_t Print::println(unsigned long value, int base) {
+    return print(value, base) + println();
+}
+
+/**
+ * Serial ports register with the clock on construction
+ */
+SimSerial::SimSerial(uint8_t rx, uint8_t tx, bool blocking) :
+    m_dropped(0),
+    m_received(0),
+    m_sent(0),
+    m_rx_pin(rx),
+    m_tx_pin(tx),
+    m_blocking(blocking),
+    m_receiver(NULL),
+    m_sink(NULL),
+    m_baud(0),
+    m_tx_done(0)
+{
+    Sim::attach(this);
+}
+SimSerial::~SimSerial() {
+    Sim::detach(this);
+}
+void SimSerial::begin(unsigned long baud) {
+    m_baud = baud;
+}
+/**
+ * Ten bits per byte: start, eight data, and stop
+ */
+uint32_t SimSerial::byte_time() const {
+    return (m_baud == 0) ? 0 : static_cast<uint32_t>(10000000UL / m_baud);
+}
+int SimSerial::available() {
+    update();
+    return static_cast<int>(m_rx.size());
+}
+int SimSerial::availableForWrite() {
+    update();
+    return SIM_SERIAL_BUFFER - 1 - static_cast<int>(m_tx.size());
+}
+int SimSerial::read() {
+    update();
+    if (m_rx.empty()) {
+        return -1;
+    }
+    uint8_t byte = m_rx.front();
+    m_rx.pop_front();
+    m_received++;
+    return byte;
+}
+int SimSerial::peek() {
+    update();
+    return m_rx.empty() ? -1 : m_rx.front();
+}
+/**
+ * Wait until all buffered bytes have left the wire
+ */
+void SimSerial::flush() {
+    while (!m_tx.empty()) {
+        Sim::advance(static_cast<uint32_t>(m_tx_done - s_now) + 1);
+    }
+}
+/**
+ * Blocking ports hold the clock for the byte, as SoftwareSerial holds the
+ * CPU. Others buffer the byte and only wait on a full buffer.
+ */
+size_t SimSerial::write(uint8_t byte) {
+    if (m_blocking) {
+        Sim::advance(byte_time());
+        finish(byte, s_now);
+        m_sent++;
+        return 1;
+    }
+    while (m_tx.size() >= (SIM_SERIAL_BUFFER - 1)) {
+        Sim::advance(static_cast<uint32_t>(m_tx_done - s_now) + 1);
+    }
+    if (m_tx.empty()) {
+        m_tx_done = s_now + byte_time();
+    }
+    m_tx.push_back(byte);
+    update();
+    return 1;
+}
+/**
+ * Buffer the byte only when there is space, never advancing the clock
+ */
+bool SimSerial::push(uint8_t byte) {
+    update();
+    if (m_tx.size() >= (SIM_SERIAL_BUFFER - 1)) {
+        return false;
+    }
+    if (m_tx.empty()) {
+        m_tx_done = s_now + byte_time();
+    }
+    m_tx.push_back(byte);
+    return true;
+}
+void SimSerial::set_receiver(SerialReceiver receiver) {
+    m_receiver = receiver;
+}
+void SimSerial::set_sink(SimSink sink) {
+    m_sink = sink;
+}
+/**
+ * Sent bytes go to the sink if there is one, or wait for collection
+ */
+void SimSerial::finish(uint8_t byte, uint64_t time) {
+    if (m_sink != NULL) {
+        m_sink(byte, time);
+        return;
+    }
+    m_out.push_back(byte);
+    m_out_time.push_back(time);
+}
+/**
+ * Queue bytes behind any already on the wire
+ */
+void SimSerial::inject(const uint8_t* data, size_t size) {
+    uint64_t arrival = s_now;
+    if (!m_arrival.empty() && m_arrival.back() > arrival) {
+        arrival = m_arrival.back();
+    }
+    for (size_t i = 0; i < size; i++) {
+        arrival += byte_time();
+        m_wire.push_back(data[i]);
+        m_arrival.push_back(arrival);
+    }
+    update();
+}
+size_t SimSerial::collect(uint8_t* data, size_t size) {
+    return collect(data, NULL, size);
+}
+size_t SimSerial::collect(uint8_t* data, uint64_t* times, size_t size) {
+    update();
+    size_t count = 0;
+    while (count < size && !m_out.empty()) {
+        data[count] = m_out.front();
+        if (times != NULL) {
+            times[count] = m_out_time.front();
+        }
+        m_out.pop_front();
+        m_out_time.pop_front();
+        count++;
+    }
+    return count;
+}
+/**
+ * Arrived bytes go to the receiver when interrupts are on and nothing is
+ * buffered ahead of them. Otherwise they drop when the receive buffer is full,
+ * as on the board.
+ */
+void SimSerial::update() {
+    while (!m_arrival.empty() && m_arrival.front() <= s_now) {
+        uint8_t byte = m_wire.front();
+        m_wire.pop_front();
+        m_arrival.pop_front();
+        if (m_receiver != NULL && s_interrupts && m_rx.empty() && m_receiver(byte)) {
+            m_received++;
+        } else if (m_rx.size() < SIM_SERIAL_BUFFER) {
+            m_rx.push_back(byte);
+        } else {
+            m_dropped++;
+        }
+    }
+    while (!m_tx.empty() && m_tx_done <= s_now) {
+        uint8_t byte = m_tx.front();
+        uint64_t done = m_tx_done;
+        m_tx.pop_front();
+        m_sent++;
+        m_tx_done += byte_time();
+        finish(byte, done);
+    }
+}
+uint64_t SimSerial::next_event() const {
+    uint64_t next = UINT64_MAX;
+    if (!m_arrival.empty()) {
+        next = m_arrival.front();
+    }
+    if (!m_tx.empty() && m_tx_done < next) {
+        next = m_tx_done;
+    }
+    return next;
+}
+void SimSerial::report(FILE* out) const {
+    fprintf(out, "serial rx=%u tx=%u baud=%lu: received %u, sent %u, dropped %u\n",
+            m_rx_pin, m_tx_pin, m_baud, m_received, m_sent, m_dropped);
+}
+
+SimPanel::SimPanel() :
+    m_on(false),
+    m_scrolling(false),
+    m_scrolls(0),
+    m_torn(0),
+    m_transfers(0),
+    m_bytes(0),
+    m_command_index(0),
+    m_command_length(0),
+    m_column_start(0),
+    m_column_end(SIM_PANEL_WIDTH - 1),
+    m_column(0),
+    m_page_start(0),
+    m_page_end(SIM_PANEL_PAGES - 1),
+    m_page(0)
+{
+    memset(m_ram, 0, sizeof(m_ram));
+}
+/**
+ * The control byte's data/command bit picks the stream. Commands carry on
+ * across transmissions, as they do on the controller.
+ */
+void SimPanel::receive(const uint8_t* data, size_t size) {
+    m_transfers++;
+    if (size == 0) {
+        return;
+    }
+    bool display = (data[0] & 0x40) != 0;
+    for (size_t i = 1; i < size; i++) {
+        if (!display) {
+            command(data[i]);
+            continue;
+        }
+        m_ram[m_page][m_column] = data[i];
+        m_bytes++;
+        m_torn += m_scrolling ? 1 : 0;
+        if (m_column < m_column_end) {
+            m_column++;
+            continue;
+        }
+        m_column = m_column_start;
+        m_page = (m_page < m_page_end) ? (m_page + 1) : m_page_start;
+    }
+}
+/**
+ * Arguments taken by the commands that have them
+ */
+static uint8_t panel_arguments(uint8_t command) {
+    switch (command) {
+        case 0x21: case 0x22: case 0xA3:
+            return 2;
+        case 0x26: case 0x27:
+            return 6;
+        case 0x29: case 0x2A:
+            return 5;
+        case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3: case 0xD5:
+        case 0xD9: case 0xDA: case 0xDB:
+            return 1;
+        default:
+            return 0;
+    }
+}
+void SimPanel::command(uint8_t byte) {
+    if (m_command_index == 0) {
+        m_command_length = 1 + panel_arguments(byte);
+    }
+    m_command[m_command_index++] = byte;
+    if (m_command_index < m_command_length) {
+        return;
+    }
+    m_command_index = 0;
+    switch (m_command[0]) {
+        case 0x21:
+            m_column_start = m_command[1] % SIM_PANEL_WIDTH;
+            m_column_end = m_command[2] % SIM_PANEL_WIDTH;
+            m_column = m_column_start;
+            break;
+        case 0x22:
+            m_page_start = m_command[1] % SIM_PANEL_PAGES;
+            m_page_end = m_command[2] % SIM_PANEL_PAGES;
+            m_page = m_page_start;
+            break;
+        case 0xAE:
+            m_on = false;
+            break;
+        case 0xAF:
+            m_on = true;
+            break;
+        case 0x2E:
+            m_scrolling = false;
+            break;
+        case 0x2F:
+            m_scrolling = true;
+            m_scrolls++;
+            break;
+        default:
+            break;
+    }
+}
+void SimPanel::report(FILE* out) const {
+    unsigned int lit = 0;
+    for (unsigned int page = 0; page < SIM_PANEL_PAGES; page++) {
+        for (unsigned int column = 0; column < SIM_PANEL_WIDTH; column++) {
+            lit += __builtin_popcount(m_ram[page][column]);
+        }
+    }
+    fprintf(out, "panel %s%s: %u transfers, %u data bytes, %u pixels lit, "
+            "%u scrolls, %u bytes written while scrolling\n",
+            m_on ? "on" : "off", m_scrolling ? " scrolling" : "", m_transfers,
+            m_bytes, lit, m_scrolls, m_torn);
+}
+
+/**
+ * Advancing the clock delivers serial bytes and timer overflows. The clock
+ * stops at each serial event and overflow on the way, such that receivers see
+ * bytes at their arrival time, and transmit buffers drain between them, as
+ * they would with interrupts.
+ */
+void Sim::advance(uint32_t us) {
+    uint64_t target = s_now + us;
+    while (true) {
+        uint64_t next = target;
+        for (unsigned int i = 0; i < s_serial_count; i++) {
+            uint64_t event = s_serials[i]->next_event();
+            next = (event < next) ? event : next;
+        }
+        next = (s_timer_next < next) ? s_timer_next : next;
+        next = (s_i2c_done < next) ? s_i2c_done : next;
+        s_now = (next > s_now) ? next : s_now;
+        for (unsigned int i = 0; i < s_serial_count; i++) {
+            s_serials[i]->update();
+        }
+        //The transmission reaches the panel as it leaves the bus
+        if (s_now >= s_i2c_done) {
+            s_i2c_done = UINT64_MAX;
+            s_i2c_status = 2;
+            if (s_i2c_address == SIM_PANEL_ADDRESS) {
+                Panel.receive(s_i2c_data, s_i2c_size);
+                s_i2c_status = 0;
+            }
+            s_i2c_pending = true;
+            if (s_interrupts) {
+                interrupts();
+            }
+        }
+        //An overflow missed while pending is lost, as on the board
+        if (s_now >= s_timer_next) {
+            s_timer_next += s_timer_period;
+            s_timer_pending = true;
+            if (s_interrupts) {
+                interrupts();
+            }
+        }
+        if (s_now >= target) {
+            break;
+        }
+    }
+}
+uint64_t Sim::now() {
+    return s_now;
+}
+void Sim::set_read_cost(uint32_t us) {
+    s_read_cost = us;
+}
+/**
+ * Drive a pin, firing the external interrupt on it for a matching edge, and
+ * its pin change interrupt for any edge
+ */
+void Sim::drive(uint8_t pin, uint8_t level) {
+    if (pin >= SIM_PIN_COUNT) {
+        return;
+    }
+    int before = digitalRead(pin);
+    s_driven[pin] = true;
+    s_drive_level[pin] = level;
+    int after = digitalRead(pin);
+    if (before == after) {
+        return;
+    }
+    s_pcint_pending[pin] = s_pcint_pending[pin] || (s_pcint[pin] != NULL);
+    int interrupt = digitalPinToInterrupt(pin);
+    if (interrupt != NOT_AN_INTERRUPT && s_isr[interrupt] != NULL) {
+        int mode = s_isr_mode[interrupt];
+        s_isr_pending[interrupt] = s_isr_pending[interrupt] || (mode == CHANGE || (mode == FALLING && after == LOW) ||
+                                    (mode == RISING && after == HIGH));
+    }
+    if (s_interrupts) {
+        interrupts();
+    }
+}
+void Sim::release(uint8_t pin) {
+    if (pin < SIM_PIN_COUNT) {
+        drive(pin, (s_mode[pin] == INPUT_PULLUP) ? HIGH : LOW);
+        s_driven[pin] = false;
+    }
+}
+uint8_t Sim::level(uint8_t pin) {
+    return (pin < SIM_PIN_COUNT) ? s_level[pin] : LOW;
+}
+int Sim::pwm(uint8_t pin) {
+    return (pin < SIM_PIN_COUNT) ? s_pwm[pin] : 0;
+}
+void Sim::attach(SimSerial* serial) {
+    if (s_serial_count < SIM_MAX_SERIAL) {
+        s_serials[s_serial_count] = serial;
+        s_serial_count++;
+    }
+}
+void Sim::detach(SimSerial* serial) {
+    for (unsigned int i = 0; i < s_serial_count; i++) {
+        if (s_serials[i] == serial) {
+            s_serial_count--;
+            s_serials[i] = s_serials[s_serial_count];
+            break;
+        }
+    }
+}
+uint32_t Sim::eeprom_writes(uint16_t address) {
+    if (address <= E2END) {
+        return s_eeprom_writes[address];
+    }
+    uint32_t total = 0;
+    for (unsigned int i = 0; i <= E2END; i++) {
+        total += s_eeprom_writes[i];
+    }
+    return total;
+}
+/**
+ * Read the run time, the EEPROM image, and any piped host bytes. The EEPROM
+ * starts erased, as from the factory.
+ */
+void Sim::begin(int argc, char** argv) {
+    if (argc > 1) {
+        s_stop = strtoull(argv[1], NULL, 10) * 1000;
+    }
+    memset(s_eeprom, 0xFF, sizeof(s_eeprom));
+    if (argc > 2) {
+        s_eeprom_file = argv[2];
+        FILE* image = fopen(s_eeprom_file, "rb");
+        if (image != NULL) {
+            size_t count = fread(s_eeprom, 1, sizeof(s_eeprom), image);
+            (void) count;
+            fclose(image);
+        }
+    }
+    if (!isatty(STDIN_FILENO)) {
+        int byte;
+        while ((byte = fgetc(stdin)) != EOF) {
+            s_stdin.push_back(static_cast<uint8_t>(byte));
+        }
+    }
+}
+/**
+ * Host bytes are injected on the first loop, once setup has set the baud
+ */
+bool Sim::running() {
+    if (!s_stdin.empty()) {
+        Serial.inject(s_stdin.data(), s_stdin.size());
+        s_stdin.clear();
+    }
+    return s_now < s_stop;
+}
+int Sim::end() {
+    uint8_t buffer[SIM_SERIAL_BUFFER];
+    size_t count;
+    while ((count = Serial.collect(buffer, sizeof(buffer))) > 0) {
+        fwrite(buffer, 1, count, stdout);
+    }
+    fflush(stdout);
+    fprintf(stderr, "time: %llums\n", static_cast<unsigned long long>(s_now / 1000));
+    for (unsigned int i = 0; i < s_serial_count; i++) {
+        s_serials[i]->report(stderr);
+    }
+    for (unsigned int i = 0; i < SIM_PIN_COUNT; i++) {
+        if (s_mode[i] == OUTPUT) {
+            fprintf(stderr, "pin %u: level %u pwm %d\n", i, s_level[i], s_pwm[i]);
+        }
+    }
+    Panel.report(stderr);
+    uint32_t most = 0;
+    for (unsigned int i = 0; i <= E2END; i++) {
+        most = (s_eeprom_writes[i] > most) ? s_eeprom_writes[i] : most;
+    }
+    fprintf(stderr, "eeprom: %lu writes, at most %lu to a byte\n",
+            static_cast<unsigned long>(Sim::eeprom_writes(E2END + 1)), static_cast<unsigned long>(most));
+    if (s_eeprom_file != NULL) {
+        FILE* image = fopen(s_eeprom_file, "wb");
+        if (image != NULL) {
+            fwrite(s_eeprom, 1, sizeof(s_eeprom), image);
+            fclose(image);
+        }
+    }
+    return 0;
+}
+#endif
@@ -0,0 +1,391 @@
+/*
+ * sim.hpp:
+ *
+ * Native simulator for the scale-switch. Supplies the subset of the Arduino
+ * API used by the firmware, such that the firmware builds and runs on a Linux
+ * host. Three things are simulated:
+ *
+ * 1. Clock: a virtual microsecond clock. It only moves when advanced, when
+ *    delay is called, and by a small fixed cost on every clock read, such that
+ *    busy loops make progress.
+ * 2. Pins: modes, levels, and PWM duty of every pin. Input pins can be driven
+ *    from the simulator side, calling attached interrupts on matching edges,
+ *    and pin change interrupts on any change. A periodic timer interrupt
+ *    stands in for a hardware timer's overflow.
+ * 3. Serial ports: in-memory ports that move bytes at their baud rate. Bytes
+ *    injected from the simulator side arrive one byte-time apart, and bytes
+ *    written by the firmware leave one byte-time apart. Blocking ports (as
+ *    SoftwareSerial) stall the clock for the whole byte-time of each write.
+ *    Arriving bytes may be taken by a receiver, as from a receive interrupt.
+ * 4. I2C bus: a master transmitter, in place of the TWI, with the OLED panel
+ *    on it keeping its display RAM. Each transmission is sent whole, leaving
+ *    the bus its bus time later, then the bus interrupt is called.
+ * 5. EEPROM: the ATmega328P's 1KB, as avr-libc's byte calls. A write takes
+ *    effect at once, but leaves the EEPROM busy for its write time, and a
+ *    write while busy stalls the clock until it is ready. Writes are counted
+ *    per byte, for wear. The contents may be kept in a file between runs, as
+ *    across a reset.
+ *
+ * Only used by the native build. See hal.hpp.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef LIB_SIM_SIM_HPP_
+#define LIB_SIM_SIM_HPP_
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+#define CHANGE 1
+#define FALLING 2
+#define RISING 3
+#define DEC 10
+#define HEX 16
+#define NOT_AN_INTERRUPT -1
+//Everything is in one address space on the host
+#define PROGMEM
+#define PSTR(str) (str)
+#define F(str) (str)
+#define pgm_read_byte_near(addr) (*reinterpret_cast<const uint8_t*>(addr))
+#define pgm_read_word_near(addr) (*(addr))
+#define pgm_read_byte(addr) pgm_read_byte_near(addr)
+#define pgm_read_word(addr) pgm_read_word_near(addr)
+#define memcpy_P(dest, src, size) memcpy((dest), (src), (size))
+//!< Number of pins on a Nano: D0-D13 and A0-A5
+#define SIM_PIN_COUNT 20
+//!< Number of external interrupts on a Nano
+#define SIM_INTERRUPT_COUNT 2
+//!< Receive buffer size, matches the host UART buffer
+#define SIM_SERIAL_BUFFER 128
+//!< Maximum number of simulated serial ports
+#define SIM_MAX_SERIAL 4
+//!< Default virtual cost of one clock read in microseconds
+#define SIM_READ_COST_US 1
+//!< Last EEPROM address, as avr-libc's
+#define E2END 0x3FF
+//!< EEPROM erase and write time of a byte in microseconds
+#define SIM_EEPROM_WRITE_US 3400
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t interrupt, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t interrupt);
+//!< Pin change interrupt of one pin, in place of the PCINT vectors
+void attachPinChange(uint8_t pin, void (*isr)(void));
+//!< Periodic timer interrupt, in place of a hardware timer's overflow vector
+void attachTimer(uint32_t period_us, void (*isr)(void));
+//!< I2C bus clock, and the interrupt called as each transmission leaves the
+//!< bus, in place of the TWI vector
+void attachI2c(uint32_t clock, void (*isr)(void));
+//!< Start an I2C transmission, the bytes copied. One at a time.
+void i2cTransmit(uint8_t address, const uint8_t* data, size_t size);
+//!< Status of the last transmission: 0 if acknowledged, 2 if no device
+uint8_t i2cStatus();
+void noInterrupts();
+void interrupts();
+//!< EEPROM byte access, as avr-libc's. Addresses are offsets in the EEPROM.
+uint8_t eeprom_read_byte(const uint8_t* address);
+void eeprom_write_byte(uint8_t* address, uint8_t value);
+bool eeprom_is_ready();
+
+/**
+ * Print:
+ *
+ * Formatting base class, as the Arduino core's Print. Subclasses implement the
+ * single byte write.
+ */
+class Print {
+    public:
+        virtual size_t write(uint8_t byte) = 0;
+        virtual size_t write(const uint8_t* buffer, size_t size);
+        size_t write(const char* buffer, size_t size);
+        size_t write(const char* str);
+        size_t print(const char* str);
+        size_t print(char value);
+        size_t print(int value, int base = DEC);
+        size_t print(unsigned int value, int base = DEC);
+        size_t print(long value, int base = DEC);
+        size_t print(unsigned long value, int base = DEC);
+        size_t println();
+        size_t println(const char* str);
+        size_t println(char value);
+        size_t println(int value, int base = DEC);
+        size_t println(unsigned int value, int base = DEC);
+        size_t println(long value, int base = DEC);
+        size_t println(unsigned long value, int base = DEC);
+        virtual ~Print() {}
+};
+
+//!< Receiver called as each byte arrives, returns true to take the byte. Also
+//!< in the firmware's types.hpp.
+typedef bool (*SerialReceiver)(uint8_t byte);
+//!< Simulator side sink called as each sent byte leaves the wire, with the time
+typedef void (*SimSink)(uint8_t byte, uint64_t time);
+
+/**
+ * SimSerial:
+ *
+ * In-memory serial port. The firmware side has the HostUart and SoftUart
+ * calls. The simulator side injects bytes on to the receive wire and collects
+ * bytes from the transmit wire. As on HostUart, a registered receiver is
+ * offered each byte as it arrives, in place of the receive interrupt.
+ */
+class SimSerial : public Print {
+    public:
+        /**
+         * Construct the port. Pins are only recorded.
+         * \param uint8_t rx: receive pin
+         * \param uint8_t tx: transmit pin
+         * \param bool blocking: writes stall the clock for their byte-time
+         */
+        SimSerial(uint8_t rx, uint8_t tx, bool blocking = false);
+        /**
+         * Unregister from the clock.
+         */
+        ~SimSerial();
+        void begin(unsigned long baud);
+        int available();
+        int availableForWrite();
+        int read();
+        int peek();
+        void flush();
+        size_t write(uint8_t byte);
+        using Print::write;
+        bool push(uint8_t byte);
+        void set_receiver(SerialReceiver receiver);
+        /**
+         * Put bytes on the receive wire. They arrive back to back at the baud
+         * rate, after any bytes already on the wire.
+         * \param const uint8_t* data: bytes to send to the firmware
+         * \param size_t size: number of bytes
+         */
+        void inject(const uint8_t* data, size_t size);
+        /**
+         * Take bytes off the transmit wire that have finished sending.
+         * \param uint8_t* data: buffer to fill
+         * \param size_t size: buffer size
+         * \return number of bytes taken
+         */
+        size_t collect(uint8_t* data, size_t size);
+        /**
+         * Take bytes off the transmit wire, along with the virtual time each
+         * one finished sending.
+         * \param uint8_t* data: buffer to fill
+         * \param uint64_t* times: buffer to fill with times
+         * \param size_t size: buffer sizes
+         * \return number of bytes taken
+         */
+        size_t collect(uint8_t* data, uint64_t* times, size_t size);
+        /**
+         * Hand sent bytes to a sink as they leave the wire, in place of
+         * collection, such that a simulated device can answer at once.
+         * \param SimSink sink: sink, or NULL to collect
+         */
+        void set_sink(SimSink sink);
+        /**
+         * Virtual time a byte takes on the wire.
+         * \return byte-time in microseconds
+         */
+        uint32_t byte_time() const;
+        /**
+         * Move arrived bytes into the receive buffer, and finished bytes off
+         * the transmit buffer. Called as the clock advances.
+         */
+        void update();
+        /**
+         * Time of the next byte to arrive or finish sending.
+         * \return virtual time, or UINT64_MAX if none
+         */
+        uint64_t next_event() const;
+        /**
+         * Print a summary of the traffic through this port.
+         * \param FILE* out: file to print to
+         */
+        void report(FILE* out) const;
+        //!< Bytes dropped on a full receive buffer
+        uint32_t m_dropped;
+        //!< Bytes received by the firmware
+        uint32_t m_received;
+        //!< Bytes sent by the firmware
+        uint32_t m_sent;
+    private:
+        /**
+         * Deliver a byte that finished sending.
+         */
+        void finish(uint8_t byte, uint64_t time);
+        //!< Receive and transmit pins
+        uint8_t m_rx_pin, m_tx_pin;
+        //!< Writes stall the clock
+        bool m_blocking;
+        //!< Receiver offered each arriving byte, as a receive interrupt
+        SerialReceiver m_receiver;
+        //!< Sink taking each sent byte, if any
+        SimSink m_sink;
+        //!< Baud rate
+        unsigned long m_baud;
+        //!< Receive buffer, readable by the firmware
+        std::deque<uint8_t> m_rx;
+        //!< Bytes on the receive wire, and their arrival times
+        std::deque<uint8_t> m_wire;
+        std::deque<uint64_t> m_arrival;
+        //!< Transmit buffer
+        std::deque<uint8_t> m_tx;
+        //!< Time the byte at the head of the transmit buffer leaves the wire
+        uint64_t m_tx_done;
+        //!< Bytes finished sending, waiting for collection, and their times
+        std::deque<uint8_t> m_out;
+        std::deque<uint64_t> m_out_time;
+};
+
+/**
+ * SimPanel:
+ *
+ * SSD1306 OLED panel on the simulated I2C bus, at SIM_PANEL_ADDRESS. Each
+ * transmission starts with a control byte, and is a stream of commands or of
+ * display data. Commands with their arguments are followed as the controller
+ * does for the page and column addressing windows, and display on and off.
+ * Data fills the addressed window of the display RAM in horizontal
+ * addressing, moving to the next page at the end of each column window.
+ * Scrolling is only followed as on or off, and data written while scrolling,
+ * which the controller does not promise to keep, is counted.
+ */
+#define SIM_PANEL_ADDRESS 0x3C
+#define SIM_PANEL_WIDTH 128
+#define SIM_PANEL_PAGES 8
+//!< Longest command, with its arguments
+#define SIM_PANEL_COMMAND 8
+//!< Longest I2C transmission
+#define SIM_I2C_BUFFER 256
+class SimPanel {
+    public:
+        SimPanel();
+        /**
+         * Take one transmission addressed to the panel.
+         * \param const uint8_t* data: bytes of the transmission
+         * \param size_t size: number of bytes
+         */
+        void receive(const uint8_t* data, size_t size);
+        /**
+         * Print a summary of the panel.
+         * \param FILE* out: file to print to
+         */
+        void report(FILE* out) const;
+        //!< Display RAM, a byte per column of each page
+        uint8_t m_ram[SIM_PANEL_PAGES][SIM_PANEL_WIDTH];
+        //!< Display is on, and scrolling
+        bool m_on;
+        bool m_scrolling;
+        //!< Scrolls started, and display data bytes written while scrolling
+        uint32_t m_scrolls;
+        uint32_t m_torn;
+        //!< Transmissions taken, and display data bytes among them
+        uint32_t m_transfers;
+        uint32_t m_bytes;
+    private:
+        /**
+         * Take one command byte, acting on each command once complete.
+         */
+        void command(uint8_t byte);
+        //!< Command being taken, its bytes so far, and its length
+        uint8_t m_command[SIM_PANEL_COMMAND];
+        uint8_t m_command_index;
+        uint8_t m_command_length;
+        //!< Column and page windows, and the next column and page written
+        uint8_t m_column_start, m_column_end, m_column;
+        uint8_t m_page_start, m_page_end, m_page;
+};
+
+/**
+ * Sim:
+ *
+ * Simulator side controls: the clock, pin drives, and the run loop of the
+ * native program.
+ */
+class Sim {
+    public:
+        /**
+         * Advance the virtual clock, delivering arrived serial bytes.
+         * \param uint32_t us: microseconds to advance
+         */
+        static void advance(uint32_t us);
+        /**
+         * Current virtual time.
+         * \return microseconds since start
+         */
+        static uint64_t now();
+        /**
+         * Set the virtual cost of each clock read.
+         * \param uint32_t us: microseconds added per read
+         */
+        static void set_read_cost(uint32_t us);
+        /**
+         * Drive an input pin from outside, as a button would. Calls the
+         * attached interrupt on a matching edge.
+         * \param uint8_t pin: pin to drive
+         * \param uint8_t level: HIGH or LOW
+         */
+        static void drive(uint8_t pin, uint8_t level);
+        /**
+         * Release a driven pin back to its pull-up or floating state.
+         * \param uint8_t pin: pin to release
+         */
+        static void release(uint8_t pin);
+        /**
+         * Level last written to, or read from, a pin.
+         */
+        static uint8_t level(uint8_t pin);
+        /**
+         * PWM duty last written to a pin.
+         */
+        static int pwm(uint8_t pin);
+        /**
+         * Register a serial port for clock updates. Called by SimSerial.
+         */
+        static void attach(SimSerial* serial);
+        /**
+         * Unregister a serial port. Called by SimSerial.
+         */
+        static void detach(SimSerial* serial);
+        /**
+         * Start the native program. Arguments: an optional run time in virtual
+         * milliseconds, then an optional EEPROM image file, read at start if
+         * it exists and written back at the end. Host bytes piped into stdin
+         * are injected into Serial.
+         */
+        static void begin(int argc, char** argv);
+        /**
+         * Should the native program keep looping.
+         */
+        static bool running();
+        /**
+         * EEPROM byte writes so far.
+         * \param uint16_t address: byte, or past E2END for all of them
+         */
+        static uint32_t eeprom_writes(uint16_t address);
+        /**
+         * End the native program, writing host output to stdout and a summary
+         * to stderr.
+         * \return program exit status
+         */
+        static int end();
+};
+//!< Host serial port, as the Arduino core's Serial
+extern SimSerial Serial;
+//!< Panel on the I2C bus
+extern SimPanel Panel;
+#endif /* LIB_SIM_SIM_HPP_ */
@@ -0,0 +1,101 @@
+/*
+ * animation.cpp:
+ *
+ * Keyframe animation implementations, and the gamma table.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <string.h>
+#include "animation.hpp"
+
+//!< Gamma 2.2 correction from linear color to PWM duty
+static const uint8_t GAMMA[256] PROGMEM = {
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+        0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+        0x03, 0x03, 0x03, 0x03, 0x03, 0x04, 0x04, 0x04, 0x04, 0x05, 0x05, 0x05, 0x05, 0x06, 0x06, 0x06,
+        0x06, 0x07, 0x07, 0x07, 0x08, 0x08, 0x08, 0x09, 0x09, 0x09, 0x0A, 0x0A, 0x0B, 0x0B, 0x0B, 0x0C,
+        0x0C, 0x0D, 0x0D, 0x0D, 0x0E, 0x0E, 0x0F, 0x0F, 0x10, 0x10, 0x11, 0x11, 0x12, 0x12, 0x13, 0x13,
+        0x14, 0x14, 0x15, 0x16, 0x16, 0x17, 0x17, 0x18, 0x19, 0x19, 0x1A, 0x1A, 0x1B, 0x1C, 0x1C, 0x1D,
+        0x1E, 0x1E, 0x1F, 0x20, 0x21, 0x21, 0x22, 0x23, 0x23, 0x24, 0x25, 0x26, 0x27, 0x27, 0x28, 0x29,
+        0x2A, 0x2B, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37,
+        0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47,
+        0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F, 0x51, 0x52, 0x53, 0x54, 0x55, 0x57, 0x58, 0x59, 0x5A,
+        0x5B, 0x5D, 0x5E, 0x5F, 0x61, 0x62, 0x63, 0x64, 0x66, 0x67, 0x69, 0x6A, 0x6B, 0x6D, 0x6E, 0x6F,
+        0x71, 0x72, 0x74, 0x75, 0x77, 0x78, 0x79, 0x7B, 0x7C, 0x7E, 0x7F, 0x81, 0x82, 0x84, 0x85, 0x87,
+        0x89, 0x8A, 0x8C, 0x8D, 0x8F, 0x91, 0x92, 0x94, 0x95, 0x97, 0x99, 0x9A, 0x9C, 0x9E, 0x9F, 0xA1,
+        0xA3, 0xA5, 0xA6, 0xA8, 0xAA, 0xAC, 0xAD, 0xAF, 0xB1, 0xB3, 0xB5, 0xB6, 0xB8, 0xBA, 0xBC, 0xBE,
+        0xC0, 0xC2, 0xC4, 0xC5, 0xC7, 0xC9, 0xCB, 0xCD, 0xCF, 0xD1, 0xD3, 0xD5, 0xD7, 0xD9, 0xDB, 0xDD,
+        0xDF, 0xE1, 0xE3, 0xE5, 0xE7, 0xEA, 0xEC, 0xEE, 0xF0, 0xF2, 0xF4, 0xF6, 0xF8, 0xFB, 0xFD, 0xFF,
+};
+
+Animation::Animation() :
+    m_pattern(NULL),
+    m_index(0),
+    m_elapsed(0),
+    m_fade(0),
+    m_step(0)
+{
+    memset(m_from, 0, sizeof(m_from));
+    memset(m_to, 0, sizeof(m_to));
+    memset(m_color, 0, sizeof(m_color));
+}
+void Animation::play(const Pattern* pattern) {
+    m_pattern = pattern;
+    start(0);
+}
+const Pattern* Animation::playing() const {
+    return m_pattern;
+}
+bool Animation::done() const {
+    return m_pattern != NULL && m_fade == 0;
+}
+/**
+ * A held pattern's last keyframe has no fade, so it stays put
+ */
+void Animation::start(uint8_t index) {
+    const Keyframe* frame = m_pattern->frames + index;
+    uint8_t next = index + 1;
+    if (next >= m_pattern->count) {
+        next = m_pattern->loop ? 0 : index;
+    }
+    m_index = index;
+    for (uint8_t i = 0; i < ANIMATION_CHANNELS; i++) {
+        m_from[i] = pgm_read_byte(frame->color + i);
+        m_to[i] = pgm_read_byte(m_pattern->frames[next].color + i);
+        m_color[i] = m_from[i];
+    }
+    m_elapsed = 0;
+    m_fade = (next == index) ? 0 : pgm_read_word(&frame->fade);
+    m_step = (next == index) ? 0 : pgm_read_word(&frame->step);
+}
+/**
+ * Time left over from a fade carries into the next
+ */
+void Animation::advance(uint16_t ms) {
+    if (m_pattern == NULL) {
+        return;
+    }
+    m_elapsed += ms;
+    while (m_fade != 0 && m_elapsed >= m_fade) {
+        uint16_t over = m_elapsed - m_fade;
+        uint8_t next = m_index + 1;
+        start((next >= m_pattern->count) ? 0 : next);
+        m_elapsed = over;
+    }
+    if (m_fade == 0) {
+        return;
+    }
+    uint8_t fraction = static_cast<uint16_t>(m_elapsed * m_step) >> 8;
+    //Unsigned, such that the product fits 16 bits
+    for (uint8_t i = 0; i < ANIMATION_CHANNELS; i++) {
+        if (m_to[i] >= m_from[i]) {
+            m_color[i] = m_from[i] + ((static_cast<uint16_t>(m_to[i] - m_from[i]) * fraction) >> 8);
+        } else {
+            m_color[i] = m_from[i] - ((static_cast<uint16_t>(m_from[i] - m_to[i]) * fraction) >> 8);
+        }
+    }
+}
+uint8_t Animation::level(uint8_t channel) const {
+    return pgm_read_byte(GAMMA + m_color[channel]);
+}
@@ -0,0 +1,110 @@
+/*
+ * animation.hpp:
+ *
+ * Fixed-point keyframe animation of an RGB color. A pattern is a list of
+ * keyframes in PROGMEM, each a color and the time taken to fade from it to
+ * the next keyframe. Patterns either loop, or hold their last keyframe once
+ * played through. A keyframe with no fade time holds too.
+ *
+ * Fades are interpolated in 8-bit fixed point: each keyframe's fade time is
+ * turned into a per-millisecond step at compile time, kept with the keyframe,
+ * such that each advance is a multiply and a shift per channel, and no
+ * division is ever done, as advances may run in interrupt context. Colors are linear, and are
+ * gamma corrected from a PROGMEM table on the way out, such that fades look
+ * even to the eye.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_ANIMATION_HPP_
+#define SRC_ANIMATION_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Channels in a color
+#define ANIMATION_CHANNELS 3
+
+/**
+ * Keyframe:
+ *
+ * A color, and the time to fade from it to the next keyframe. Stored in
+ * PROGMEM.
+ */
+struct Keyframe {
+    uint8_t color[ANIMATION_CHANNELS]; //!< Red, green, and blue, 0-255 linear
+    uint16_t fade;                     //!< Fade to the next keyframe in ms, 0 to hold
+    uint16_t step;                     //!< Fraction of the fade per ms, 0.16 fixed point
+};
+/**
+ * Make a keyframe, its step worked out at compile time. Below the fade time,
+ * elapsed times step stays within 16 bits.
+ * \param uint8_t red: red, 0-255 linear
+ * \param uint8_t green: green, 0-255 linear
+ * \param uint8_t blue: blue, 0-255 linear
+ * \param uint16_t fade: fade to the next keyframe in ms, 0 to hold
+ */
+constexpr Keyframe keyframe(uint8_t red, uint8_t green, uint8_t blue, uint16_t fade) {
+    return Keyframe{{red, green, blue}, fade,
+                    static_cast<uint16_t>((fade > 1) ? (0x10000UL / fade) : 0)};
+}
+/**
+ * Pattern:
+ *
+ * Keyframes played in order.
+ */
+struct Pattern {
+    const Keyframe* frames; //!< Keyframes, in PROGMEM
+    uint8_t count;          //!< Number of keyframes
+    bool loop;              //!< Start over after the last, else hold it
+};
+
+class Animation {
+    public:
+        /**
+         * Construct with no pattern: all channels off.
+         */
+        Animation();
+        /**
+         * Start playing a pattern from its first keyframe.
+         * \param const Pattern* pattern: pattern to play
+         */
+        void play(const Pattern* pattern);
+        /**
+         * Pattern playing.
+         * \return pattern, or NULL for none
+         */
+        const Pattern* playing() const;
+        /**
+         * Has the pattern reached a keyframe it holds.
+         */
+        bool done() const;
+        /**
+         * Advance the animation.
+         * \param uint16_t ms: time passed in ms
+         */
+        void advance(uint16_t ms);
+        /**
+         * Gamma corrected level of a channel.
+         * \param uint8_t channel: channel, less than ANIMATION_CHANNELS
+         * \return PWM duty, 0-255
+         */
+        uint8_t level(uint8_t channel) const;
+    private:
+        /**
+         * Start the fade out of a keyframe.
+         * \param uint8_t index: keyframe index
+         */
+        void start(uint8_t index);
+        //!< Pattern playing
+        const Pattern* m_pattern;
+        //!< Keyframe fading out, and its color and the next one's
+        uint8_t m_index;
+        uint8_t m_from[ANIMATION_CHANNELS];
+        uint8_t m_to[ANIMATION_CHANNELS];
+        //!< Time into the fade, its length, and the fraction step per ms
+        uint16_t m_elapsed;
+        uint16_t m_fade;
+        uint16_t m_step;
+        //!< Current linear color
+        uint8_t m_color[ANIMATION_CHANNELS];
+};
+#endif /* SRC_ANIMATION_HPP_ */
@@ -0,0 +1,56 @@
+/*
+ * boot.cpp:
+ *
+ * Staged boot implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include "boot.hpp"
+//Concrete definitions
+uint32_t Boot::s_live = 0;
+volatile uint32_t Boot::s_forwarded = 0;
+uint32_t Boot::s_stages[BOOT_MAX_STAGES];
+uint8_t Boot::s_staged = 0;
+
+Boot::Boot(Runner* stages[], uint8_t count) :
+    Runner(BOOT_PERIOD_MS),
+    m_stages(stages),
+    m_count((count < BOOT_MAX_STAGES) ? count : BOOT_MAX_STAGES)
+{}
+/**
+ * A stage failing its setup is reported by attach, and the boot moves on
+ */
+void Boot::run() {
+    if (s_staged >= m_count) {
+        return;
+    }
+    Runner::attach(m_stages[s_staged]);
+    s_stages[s_staged] = micros();
+    s_staged++;
+    if (s_staged == m_count) {
+        m_period = BOOT_IDLE_PERIOD_MS;
+    }
+}
+void Boot::live() {
+    s_live = micros();
+}
+/**
+ * The first forwarded time is read with interrupts off, as it is set in them
+ */
+void Boot::report(Print& out) {
+    noInterrupts();
+    uint32_t forwarded = s_forwarded;
+    interrupts();
+    out.print(F("<BOOT live="));
+    out.print(s_live);
+    out.print(F(" fwd="));
+    out.print(forwarded);
+    for (uint8_t i = 0; i < s_staged; i++) {
+        out.print(F(" s"));
+        out.print(i);
+        out.print('=');
+        out.print(s_stages[i]);
+    }
+    out.println('>');
+}
@@ -0,0 +1,73 @@
+/*
+ * boot.hpp:
+ *
+ * Staged boot. setup only starts what the passthrough needs: the serial ports,
+ * the buttons, and the schedule, so host bytes are forwarded within
+ * milliseconds of reset. The Boot runner then brings the rest up from the
+ * scheduler, one stage each period: each stage's runner is set up and attached
+ * to the schedule. No stage waits on its hardware; slow set up, such as
+ * clearing the OLED, is left to the runner's own runs.
+ *
+ * The time of each step is kept, in microseconds from reset, and printed on
+ * request as "<BOOT live=... fwd=... s0=... s1=...>": when setup had the
+ * passthrough live, when the first host byte was forwarded to the matrix, and
+ * when each stage was up. A first forward not yet seen prints as 0, and
+ * stages not yet up are left off.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_BOOT_HPP_
+#define SRC_BOOT_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+#include "runner.hpp"
+//!< Period between boot stages
+#define BOOT_PERIOD_MS 20
+//!< Period once every stage is up, as the runner cannot leave the schedule
+#define BOOT_IDLE_PERIOD_MS 60000
+//!< Most boot stages
+#define BOOT_MAX_STAGES 4
+
+class Boot : public Runner {
+    public:
+        /**
+         * Construct the sequencer over its stages, brought up in order.
+         * \param Runner* stages[]: runners to set up, one per stage
+         * \param uint8_t count: stages, up to BOOT_MAX_STAGES
+         */
+        Boot(Runner* stages[], uint8_t count);
+        /**
+         * Bring the next stage up.
+         */
+        void run();
+        /**
+         * Record the passthrough as live. Called at the end of setup.
+         */
+        static void live();
+        /**
+         * Record a byte forwarded to the matrix. Safe in interrupt context,
+         * and cheap once the first is recorded.
+         */
+        static inline void forwarded() {
+            if (s_forwarded == 0) {
+                s_forwarded = micros();
+            }
+        }
+        /**
+         * Print the boot timings as a single framed line.
+         * \param Print& out: output to print to
+         */
+        static void report(Print& out);
+    private:
+        //!< Runners of each stage, and how many there are
+        Runner** m_stages;
+        uint8_t m_count;
+        //!< Time the passthrough was live, and the first byte was forwarded
+        static uint32_t s_live;
+        static volatile uint32_t s_forwarded;
+        //!< Time each stage was up, and the stages up so far
+        static uint32_t s_stages[BOOT_MAX_STAGES];
+        static uint8_t s_staged;
+};
+#endif /* SRC_BOOT_HPP_ */
@@ -0,0 +1,95 @@
+/*
+ * bus.hpp:
+ *
+ * Compile-time event bus. A Bus is a list of subscribers, fixed as template
+ * arguments, and publishing an event to it calls each subscriber's handler
+ * for that event directly, in list order. There is no subscriber table and
+ * no virtual call: each publish unrolls at compile time into one call per
+ * subscriber, on the subscriber's own type, which the compiler may inline.
+ *
+ * Subscribers are global objects, named by Subscriber<TYPE, OBJECT>. Each
+ * event type names the handler it is delivered to, such that a subscriber
+ * handles an event by declaring a method of that name. A handler hides the
+ * base class one of the same name, rather than overriding it.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_BUS_HPP_
+#define SRC_BUS_HPP_
+#include "types.hpp"
+/**
+ * PressEvent:
+ *
+ * A button was pressed. Delivered to button_pressed.
+ */
+struct PressEvent {
+    ButtonType button; //!< Button pressed
+    template <class SUBSCRIBER>
+    void deliver(SUBSCRIBER& subscriber) const {
+        subscriber.button_pressed(button);
+    }
+};
+/**
+ * SerialEvent:
+ *
+ * Bytes were written to a serial port. Delivered to serial_written.
+ */
+struct SerialEvent {
+    SerialType serial; //!< Port written to
+    template <class SUBSCRIBER>
+    void deliver(SUBSCRIBER& subscriber) const {
+        subscriber.serial_written(serial);
+    }
+};
+/**
+ * ErrorEvent:
+ *
+ * An error was reported. Delivered to error.
+ */
+struct ErrorEvent {
+    const char* file;    //!< File where the error occurred
+    int line;            //!< Line in file where the error occurred
+    const char* message; //!< Error message
+    template <class SUBSCRIBER>
+    void deliver(SUBSCRIBER& subscriber) const {
+        subscriber.error(file, line, message);
+    }
+};
+/**
+ * Names a global object as a subscriber.
+ */
+template <class TYPE, TYPE& OBJECT>
+struct Subscriber {
+    template <class EVENT>
+    static inline void receive(const EVENT& event) {
+        event.deliver(OBJECT);
+    }
+};
+/**
+ * Bus of the listed subscribers.
+ */
+template <class... SUBSCRIBERS>
+class Bus;
+template <>
+class Bus<> {
+    public:
+        template <class EVENT>
+        static inline void publish(const EVENT& event) {
+            (void) event;
+        }
+};
+template <class FIRST, class... REST>
+class Bus<FIRST, REST...> {
+    public:
+        /**
+         * Publish an event to each subscriber, in list order.
+         * \param const EVENT& event: event to publish
+         */
+        template <class EVENT>
+        static inline void publish(const EVENT& event) {
+            FIRST::receive(event);
+            Bus<REST...>::publish(event);
+        }
+};
+#endif /* SRC_BUS_HPP_ */
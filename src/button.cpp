@@ -7,69 +7,148 @@
  *      Author: lestarch
  */
 #include "button.hpp"
-//Initialize static pointer
-Button* Button::s_interrupt = NULL;
+//!< Event queue index mask
+#define BUTTON_EVENT_MASK (BUTTON_EVENTS - 1)
+//Initialize statics
+ButtonBase* ButtonBase::s_interrupts[BUTTON_MAX_INTERRUPT];
+uint8_t ButtonBase::s_interrupt_count = 0;
+ButtonEvent ButtonBase::s_events[BUTTON_EVENTS];
+volatile uint8_t ButtonBase::s_head = 0;
+volatile uint8_t ButtonBase::s_tail = 0;
+volatile uint16_t ButtonBase::s_dropped = 0;
+Timing ButtonBase::s_latency;
 /**
- * ISR handler for use in interrupt registry
+ * ISR handler for use in pin change registry
  */
 void button_isr() {
-    //Don't call button if NULL
-    if (Button::s_interrupt != NULL) {
-        Button::s_interrupt->handle();
-    }
+    ButtonBase::change();
+}
+#ifdef ARDUINO
+//Every pin change bank leads to the same scan of the buttons
+ISR(PCINT0_vect) {
+    button_isr();
+}
+ISR(PCINT1_vect) {
+    button_isr();
 }
+ISR(PCINT2_vect) {
+    button_isr();
+}
+#endif
 
 /**
- * Button constructor implementation. This handles interrupt registry and
- * setting up the pin type.
+ * Button constructor implementation. This handles interrupt registry. The pin
+ * is set up by Button.
  */
-Button::Button(int pin, int debounce, ButtonType type, bool interrupt) :
+ButtonBase::ButtonBase(int pin, int debounce, ButtonType type, bool interrupt) :
+    Runner(BUTTON_PERIOD_MS),
     m_pin(pin),
     m_debounce(debounce),
     m_last(0),
     m_handler(NULL),
-    m_type(type)
+    m_type(type),
+    m_interrupt(false),
+    m_active(false)
 {
-    pinMode(pin, INPUT_PULLUP);
     //Free to handle interrupt, and want to handle interrupt
-    if (Button::s_interrupt != NULL && interrupt) {
-        attachInterrupt(digitalPinToInterrupt(m_pin), button_isr, EDGE);
+    if (s_interrupt_count < BUTTON_MAX_INTERRUPT && interrupt) {
+        s_interrupts[s_interrupt_count] = this;
+        s_interrupt_count++;
         m_interrupt = true;
-    } else {
-        m_interrupt = false;
     }
 }
 /**
  * Register the button handler.
  */
-void Button::register_handler(ButtonHandle handler) {
+void ButtonBase::register_handler(ButtonHandle handler) {
     m_handler = handler;
 }
 /**
- * Handle the button press. This includes debouncing and calling registered
- * callback function.
+ * The level is sampled before enabling, such that change sees edges from it
+ */
+bool ButtonBase::setup() {
+    if (m_interrupt) {
+        m_active = active();
+        pin_change_attach(m_pin, button_isr);
+    }
+    return true;
+}
+/**
+ * Handle the button press. This includes debouncing and queuing the press for
+ * dispatch.
  */
-void Button::handle() {
-    unsigned int current = millis();
+void ButtonBase::handle() {
+    uint16_t current = millis();
     //Brake out early when debouncing
-    //Note: will fail safely on overflow (shorter debounce interval)
-    if ((current > m_last) && (current < (m_last + m_debounce))) {
+    //Note: unsigned difference handles rollover
+    if (static_cast<uint16_t>(current - m_last) < static_cast<uint16_t>(m_debounce)) {
         return;
     }
-    //Call registered callback
-    else if (m_handler != NULL) {
-        m_handler(m_type);
-    }
     m_last = current;
+    //Queue the press, or count it lost
+    if (static_cast<uint8_t>(s_head - s_tail) >= BUTTON_EVENTS) {
+        s_dropped++;
+        return;
+    }
+    ButtonEvent& event = s_events[s_head & BUTTON_EVENT_MASK];
+    event.button = this;
+    event.time = micros();
+    s_head = s_head + 1;
+}
+/**
+ * Pin change interrupts only say a pin in the bank changed, so every
+ * interrupt driven button is checked for a press
+ */
+void ButtonBase::change() {
+    for (uint8_t i = 0; i < s_interrupt_count; i++) {
+        ButtonBase* button = s_interrupts[i];
+        bool active = button->active();
+        if (active != button->m_active) {
+            button->m_active = active;
+            if (active) {
+                button->handle();
+            }
+        }
+    }
+}
+/**
+ * Each event is copied out before its slot is freed, and handled with
+ * interrupts on
+ */
+void ButtonBase::dispatch() {
+    while (s_tail != s_head) {
+        ButtonEvent event = s_events[s_tail & BUTTON_EVENT_MASK];
+        s_tail = s_tail + 1;
+        s_latency.record(micros() - event.time);
+        if (event.button->m_handler != NULL) {
+            event.button->m_handler(event.button->m_type);
+        }
+    }
+}
+/**
+ * Print as "<BTN ...>" with lost presses ahead of the latency
+ */
+void ButtonBase::report(Print& out) {
+    out.print(F("<BTN drop="));
+    out.print(s_dropped);
+    out.print(' ');
+    s_latency.report(out);
+    out.println('>');
+}
+void ButtonBase::reset_telemetry() {
+    s_dropped = 0;
+    s_latency.clear();
 }
 /**
- * Run handler called every N milliseconds. Here the button state is polled
- * every N milliseconds, if not in interrupt mode.
+ * Run handler called every BUTTON_PERIOD_MS. Here the button state is polled
+ * every BUTTON_PERIOD_MS, if not in interrupt mode. Interrupts are held off
+ * while queuing, as the interrupts queue presses too.
  */
-void Button::run() {
+void ButtonBase::run() {
     //If not interrupt driven and the pin is "active" trigger press
-    if (!m_interrupt && digitalRead(m_pin) == ACTIVE) {
+    if (!m_interrupt && active()) {
+        noInterrupts();
         this->handle();
+        interrupts();
     }
 }
-
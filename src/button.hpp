@@ -7,67 +7,157 @@
  * Arduino only offers pull-up resistors, this button is active low or
  * falling edge driven.
  *
+ * Any number of buttons may be interrupt driven, from pin change interrupts.
+ * Interrupts and polls only queue a debounced, timestamped press event. The
+ * events are dispatched to the handlers by dispatch, outside of interrupt
+ * context, from the main loop and the serial passthrough. Presses are thus
+ * handled within a passthrough loop, rather than at the next poll, and the
+ * handlers need not be interrupt safe.
+ *
+ * Button<PIN> reads its pin through Pin<PIN>, resolved at compile time.
+ * ButtonBase holds the rest, such that buttons on different pins share the
+ * event queue.
+ *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
 #ifndef SRC_BUTTON_HPP_
 #define SRC_BUTTON_HPP_
-#include <Arduino.h>
+#include "hal.hpp"
 #include "types.hpp"
 #include "runner.hpp"
+#include "timing.hpp"
+#include "pin.hpp"
+//!< Poll period for buttons, short to keep press latency low
+#define BUTTON_PERIOD_MS 10
+//!< Most buttons that may be interrupt driven
+#define BUTTON_MAX_INTERRUPT 4
+//!< Press events queued for dispatch, must be a power of two
+#define BUTTON_EVENTS 8
 //!< External handler for button
 typedef void (*ButtonHandle)(ButtonType button);
-class Button : public Runner
+class ButtonBase;
+/**
+ * ButtonEvent:
+ *
+ * A debounced press, waiting for dispatch.
+ */
+struct ButtonEvent {
+    ButtonBase* button; //!< Button pressed
+    uint32_t time;  //!< Time of the press from micros
+};
+class ButtonBase : public Runner
 {
-    //!< Buttons are active low when pressed
-    const int ACTIVE = LOW;
-    //!< Buttons trigger on a falling edge
-    const int EDGE = FALLING;
-
     public:
         /**
          * Constructor. Wraps pin. If set to interrupt, will trigger on
-         * interrupt, unless another pin is already using an interrupt.
+         * pin change interrupts, unless BUTTON_MAX_INTERRUPT buttons already
+         * do.
          * \param int pin: pin to wrap
          * \param int debounce: debounce interval in ms
          * \param ButtonType type: type of this button
          * \param bool interrupt: should this attempt to be interrupt driven?
          */
-        Button(int pin, int debounce, ButtonType type, bool interrupt);
+        ButtonBase(int pin, int debounce, ButtonType type, bool interrupt);
 
         /**
-         * Register a handler for this buttons press event. Note: if handling
-         * interrupt based clicks, this must be fast as it will run in
-         * interrupt context.
+         * Register a handler for this buttons press event. Handlers are called
+         * by dispatch, never in interrupt context.
          * \param ButtonHandle handler: handler function to call on press
          */
         void register_handler(ButtonHandle handler);
 
         /**
-         * Helper function called on press of the button.
+         * Enable the pin change interrupt of interrupt driven buttons.
+         * \return true
+         */
+        bool setup();
+
+        /**
+         * Is the button held down. Buttons are active low when pressed.
+         */
+        virtual bool active() = 0;
+
+        /**
+         * Helper function called on press of the button. Debounces the press,
+         * and queues it. Called in interrupt context, or with interrupts off.
          */
         void handle();
 
         /**
-         * Run handler called every 1/Nms
+         * Run handler called every BUTTON_PERIOD_MS
          */
         void run();
 
-        //!< Only one button interrupt allowed, the rest will be polled.
-        static Button* s_interrupt;
+        /**
+         * Look for presses on the interrupt driven buttons. Called from the
+         * pin change interrupts.
+         */
+        static void change();
+
+        /**
+         * Call the handlers of queued presses, oldest first.
+         */
+        static void dispatch();
+
+        /**
+         * Print the press counters and dispatch latency as a report line.
+         * \param Print& out: output to print to
+         */
+        static void report(Print& out);
+
+        /**
+         * Clear the press counters and dispatch latency.
+         */
+        static void reset_telemetry();
     private:
         //!< Pin to wrap
         int m_pin;
         //!< Debounce interval in milliseconds
         int m_debounce;
         //!< Last pressed time (fill will millis() call
-        unsigned int m_last;
+        uint16_t m_last;
         //!< Button press handler function
         ButtonHandle m_handler;
         //!< Button type of this button
         ButtonType m_type;
         //!< Interrupt driven or polling
         bool m_interrupt;
+        //!< Held down when last seen by change
+        bool m_active;
+        //!< Interrupt driven buttons
+        static ButtonBase* s_interrupts[BUTTON_MAX_INTERRUPT];
+        static uint8_t s_interrupt_count;
+        //!< Queued presses, written by handle, read by dispatch. Head and tail
+        //!< count freely, and are masked to index.
+        static ButtonEvent s_events[BUTTON_EVENTS];
+        static volatile uint8_t s_head;
+        static volatile uint8_t s_tail;
+        //!< Presses lost on a full queue
+        static volatile uint16_t s_dropped;
+        //!< Time from press to dispatch
+        static Timing s_latency;
+};
+/**
+ * Button on a pin known at compile time.
+ */
+template <uint8_t PIN>
+class Button : public ButtonBase {
+    public:
+        /**
+         * Constructor. Sets the pin up as a pulled up input.
+         * \param int debounce: debounce interval in ms
+         * \param ButtonType type: type of this button
+         * \param bool interrupt: should this attempt to be interrupt driven?
+         */
+        Button(int debounce, ButtonType type, bool interrupt) :
+            ButtonBase(PIN, debounce, type, interrupt)
+        {
+            Pin<PIN>::input_pullup();
+        }
+        bool active() {
+            return !Pin<PIN>::read();
+        }
 };
 
 #endif /* SRC_BUTTON_HPP_ */
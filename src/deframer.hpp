@@ -0,0 +1,161 @@
+/*
+ * deframer.hpp:
+ *
+ * Grammar of the host stream, as tables built at compile time. Each host byte
+ * is sorted into a class by a 256 entry table, and the deframer's state and
+ * the byte's class index a transition table giving the action to take and the
+ * state to move to. Deframing a byte is thus two table reads and a jump on the
+ * action, whatever the byte and however many frame types there are.
+ *
+ * The grammar:
+ *
+ *   IDLE     '<' opens a text control frame, STX a binary frame, and 'M' a
+ *            matrix frame. Anything else is ignored.
+ *   COMMAND  '>' emits the frame to the main loop, and '<' restarts it,
+ *            counted as a resync. Anything else is captured.
+ *   MSG1     Bytes are forwarded to the matrix, a 'T' moving on to MSG2.
+ *   MSG2     Bytes are forwarded, a 'T' ending the frame.
+ *   BINARY   Bytes are taken by count: length, sequence, payload, and CRC.
+ *
+ * The actions' hooks may still end a frame early, as when it overruns, and may
+ * refuse a byte, leaving it buffered and the state as it was.
+ *
+ * Both tables are made by expanding a constexpr function over every index, so
+ * the grammar is only written once, in deframe_class and deframe_transition.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_DEFRAMER_HPP_
+#define SRC_DEFRAMER_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Host control frame delimiters, and the binary frame start
+#define START_CMD '<'
+#define END_CMD '>'
+#define BINARY_START 0x02
+//!< Matrix frame start, and the character ending each part of it
+#define MATRIX_START 'M'
+#define MATRIX_PART_END 'T'
+//!< Bits of the next state in a transition, the action above them
+#define DEFRAME_STATE_BITS 3
+#define DEFRAME_STATE_MASK ((1 << DEFRAME_STATE_BITS) - 1)
+
+enum SerialState {
+    IDLE,    // Nothing going on
+    COMMAND, // Processing a command
+    MSG1,    // First part of message (before first T)
+    MSG2,    // Second part of message (before closing T)
+    BINARY,  // Binary frame, after its start
+    SERIAL_STATES
+};
+/**
+ * DeframeClass:
+ *
+ * Classes of host byte the grammar tells apart.
+ */
+enum DeframeClass {
+    CLASS_OTHER,  //!< Any byte not below
+    CLASS_START,  //!< START_CMD
+    CLASS_END,    //!< END_CMD
+    CLASS_BINARY, //!< BINARY_START
+    CLASS_MATRIX, //!< MATRIX_START
+    CLASS_PART,   //!< MATRIX_PART_END
+    DEFRAME_CLASSES
+};
+/**
+ * DeframeAction:
+ *
+ * What to do with a host byte.
+ */
+enum DeframeAction {
+    ACTION_IGNORE,       //!< Drop the byte
+    ACTION_OPEN_COMMAND, //!< Start capturing a text control frame
+    ACTION_OPEN_BINARY,  //!< Start taking a binary frame
+    ACTION_OPEN_MATRIX,  //!< Start a matrix frame
+    ACTION_CAPTURE,      //!< Capture the byte into the control frame
+    ACTION_COUNT,        //!< Count a resync, restarting the control frame
+    ACTION_EMIT,         //!< Hand the control frame to the main loop
+    ACTION_FORWARD,      //!< Forward the byte to the matrix
+    ACTION_FORWARD_END,  //!< Forward the last byte of a matrix frame
+    ACTION_BINARY,       //!< Take a binary frame byte, by count
+};
+/**
+ * Class of a host byte.
+ */
+constexpr uint8_t deframe_class(uint8_t byte) {
+    return (byte == static_cast<uint8_t>(START_CMD)) ? CLASS_START :
+           (byte == static_cast<uint8_t>(END_CMD)) ? CLASS_END :
+           (byte == BINARY_START) ? CLASS_BINARY :
+           (byte == static_cast<uint8_t>(MATRIX_START)) ? CLASS_MATRIX :
+           (byte == static_cast<uint8_t>(MATRIX_PART_END)) ? CLASS_PART : CLASS_OTHER;
+}
+/**
+ * Pack an action and the state to move to.
+ */
+constexpr uint8_t deframe_step(DeframeAction action, SerialState next) {
+    return static_cast<uint8_t>((action << DEFRAME_STATE_BITS) | next);
+}
+/**
+ * Transition from a state on a byte class: the grammar.
+ */
+constexpr uint8_t deframe_transition(uint8_t state, uint8_t type) {
+    return (state == IDLE) ?
+               ((type == CLASS_START) ? deframe_step(ACTION_OPEN_COMMAND, COMMAND) :
+                (type == CLASS_BINARY) ? deframe_step(ACTION_OPEN_BINARY, BINARY) :
+                (type == CLASS_MATRIX) ? deframe_step(ACTION_OPEN_MATRIX, MSG1) :
+                                         deframe_step(ACTION_IGNORE, IDLE)) :
+           (state == COMMAND) ?
+               ((type == CLASS_END) ? deframe_step(ACTION_EMIT, IDLE) :
+                (type == CLASS_START) ? deframe_step(ACTION_COUNT, COMMAND) :
+                                        deframe_step(ACTION_CAPTURE, COMMAND)) :
+           (state == MSG1) ?
+               ((type == CLASS_PART) ? deframe_step(ACTION_FORWARD, MSG2) :
+                                       deframe_step(ACTION_FORWARD, MSG1)) :
+           (state == MSG2) ?
+               ((type == CLASS_PART) ? deframe_step(ACTION_FORWARD_END, IDLE) :
+                                       deframe_step(ACTION_FORWARD, MSG2)) :
+           deframe_step(ACTION_BINARY, BINARY);
+}
+/**
+ * Sequence of table indices, and its generator.
+ */
+template <uint16_t... INDICES>
+struct DeframeIndices {};
+template <uint16_t COUNT, uint16_t... INDICES>
+struct DeframeSequence : DeframeSequence<COUNT - 1, COUNT - 1, INDICES...> {};
+template <uint16_t... INDICES>
+struct DeframeSequence<0, INDICES...> {
+    typedef DeframeIndices<INDICES...> type;
+};
+/**
+ * Class of each byte, expanded over every byte.
+ */
+template <class SEQUENCE>
+struct DeframeClasses;
+template <uint16_t... INDICES>
+struct DeframeClasses<DeframeIndices<INDICES...> > {
+    static const uint8_t TABLE[sizeof...(INDICES)];
+};
+template <uint16_t... INDICES>
+const uint8_t DeframeClasses<DeframeIndices<INDICES...> >::TABLE[sizeof...(INDICES)] PROGMEM = {
+    deframe_class(static_cast<uint8_t>(INDICES))...
+};
+/**
+ * Transitions, expanded over state times DEFRAME_CLASSES plus class.
+ */
+template <class SEQUENCE>
+struct DeframeTransitions;
+template <uint16_t... INDICES>
+struct DeframeTransitions<DeframeIndices<INDICES...> > {
+    static const uint8_t TABLE[sizeof...(INDICES)];
+};
+template <uint16_t... INDICES>
+const uint8_t DeframeTransitions<DeframeIndices<INDICES...> >::TABLE[sizeof...(INDICES)] PROGMEM = {
+    deframe_transition(INDICES / DEFRAME_CLASSES, INDICES % DEFRAME_CLASSES)...
+};
+//!< Tables of the grammar
+typedef DeframeClasses<DeframeSequence<256>::type> DeframeClassTable;
+typedef DeframeTransitions<DeframeSequence<SERIAL_STATES * DEFRAME_CLASSES>::type> DeframeTransitionTable;
+static_assert(SERIAL_STATES <= (1 << DEFRAME_STATE_BITS), "States must fit a transition");
+#endif /* SRC_DEFRAMER_HPP_ */
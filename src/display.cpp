@@ -0,0 +1,232 @@
+/*
+ * display.cpp:
+ *
+ * Framebuffer-free SSD1306 text driver implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <string.h>
+#include "display.hpp"
+//!< Control bytes: a stream of commands, or of display data
+#define DISPLAY_COMMANDS 0x00
+#define DISPLAY_DATA 0x40
+//!< Commands addressing a window of columns and of pages
+#define DISPLAY_COLUMN_ADDRESS 0x21
+#define DISPLAY_PAGE_ADDRESS 0x22
+//!< Commands setting up a left scroll, and stopping and starting scrolls
+#define DISPLAY_SCROLL_LEFT 0x27
+#define DISPLAY_SCROLL_STOP 0x2E
+#define DISPLAY_SCROLL_START 0x2F
+//!< Bytes of the addressing and of the scroll command sequences
+#define DISPLAY_ADDRESSING 6
+#define DISPLAY_SCROLLING 8
+//!< First and last characters in the font, others are drawn blank
+#define DISPLAY_FONT_FIRST ' '
+#define DISPLAY_FONT_LAST '~'
+
+//!< 5x7 font of printable ASCII, a byte per column, least significant bit at
+//!< the top
+static const uint8_t FONT[] PROGMEM = {
+        0x00, 0x00, 0x00, 0x00, 0x00, //!< ' '
+        0x00, 0x00, 0x5F, 0x00, 0x00, //!< '!'
+        0x00, 0x07, 0x00, 0x07, 0x00, //!< '"'
+        0x14, 0x7F, 0x14, 0x7F, 0x14, //!< '#'
+        0x24, 0x2A, 0x7F, 0x2A, 0x12, //!< '$'
+        0x23, 0x13, 0x08, 0x64, 0x62, //!< '%'
+        0x36, 0x49, 0x55, 0x22, 0x50, //!< '&'
+        0x00, 0x05, 0x03, 0x00, 0x00, //!< '\''
+        0x00, 0x1C, 0x22, 0x41, 0x00, //!< '('
+        0x00, 0x41, 0x22, 0x1C, 0x00, //!< ')'
+        0x14, 0x08, 0x3E, 0x08, 0x14, //!< '*'
+        0x08, 0x08, 0x3E, 0x08, 0x08, //!< '+'
+        0x00, 0x50, 0x30, 0x00, 0x00, //!< ','
+        0x08, 0x08, 0x08, 0x08, 0x08, //!< '-'
+        0x00, 0x60, 0x60, 0x00, 0x00, //!< '.'
+        0x20, 0x10, 0x08, 0x04, 0x02, //!< '/'
+        0x3E, 0x51, 0x49, 0x45, 0x3E, //!< '0'
+        0x00, 0x42, 0x7F, 0x40, 0x00, //!< '1'
+        0x42, 0x61, 0x51, 0x49, 0x46, //!< '2'
+        0x21, 0x41, 0x45, 0x4B, 0x31, //!< '3'
+        0x18, 0x14, 0x12, 0x7F, 0x10, //!< '4'
+        0x27, 0x45, 0x45, 0x45, 0x39, //!< '5'
+        0x3C, 0x4A, 0x49, 0x49, 0x30, //!< '6'
+        0x01, 0x71, 0x09, 0x05, 0x03, //!< '7'
+        0x36, 0x49, 0x49, 0x49, 0x36, //!< '8'
+        0x06, 0x49, 0x49, 0x29, 0x1E, //!< '9'
+        0x00, 0x36, 0x36, 0x00, 0x00, //!< ':'
+        0x00, 0x56, 0x36, 0x00, 0x00, //!< ';'
+        0x08, 0x14, 0x22, 0x41, 0x00, //!< '<'
+        0x14, 0x14, 0x14, 0x14, 0x14, //!< '='
+        0x00, 0x41, 0x22, 0x14, 0x08, //!< '>'
+        0x02, 0x01, 0x51, 0x09, 0x06, //!< '?'
+        0x32, 0x49, 0x79, 0x41, 0x3E, //!< '@'
+        0x7E, 0x11, 0x11, 0x11, 0x7E, //!< 'A'
+        0x7F, 0x49, 0x49, 0x49, 0x36, //!< 'B'
+        0x3E, 0x41, 0x41, 0x41, 0x22, //!< 'C'
+        0x7F, 0x41, 0x41, 0x22, 0x1C, //!< 'D'
+        0x7F, 0x49, 0x49, 0x49, 0x41, //!< 'E'
+        0x7F, 0x09, 0x09, 0x09, 0x01, //!< 'F'
+        0x3E, 0x41, 0x49, 0x49, 0x7A, //!< 'G'
+        0x7F, 0x08, 0x08, 0x08, 0x7F, //!< 'H'
+        0x00, 0x41, 0x7F, 0x41, 0x00, //!< 'I'
+        0x20, 0x40, 0x41, 0x3F, 0x01, //!< 'J'
+        0x7F, 0x08, 0x14, 0x22, 0x41, //!< 'K'
+        0x7F, 0x40, 0x40, 0x40, 0x40, //!< 'L'
+        0x7F, 0x02, 0x0C, 0x02, 0x7F, //!< 'M'
+        0x7F, 0x04, 0x08, 0x10, 0x7F, //!< 'N'
+        0x3E, 0x41, 0x41, 0x41, 0x3E, //!< 'O'
+        0x7F, 0x09, 0x09, 0x09, 0x06, //!< 'P'
+        0x3E, 0x41, 0x51, 0x21, 0x5E, //!< 'Q'
+        0x7F, 0x09, 0x19, 0x29, 0x46, //!< 'R'
+        0x46, 0x49, 0x49, 0x49, 0x31, //!< 'S'
+        0x01, 0x01, 0x7F, 0x01, 0x01, //!< 'T'
+        0x3F, 0x40, 0x40, 0x40, 0x3F, //!< 'U'
+        0x1F, 0x20, 0x40, 0x20, 0x1F, //!< 'V'
+        0x3F, 0x40, 0x38, 0x40, 0x3F, //!< 'W'
+        0x63, 0x14, 0x08, 0x14, 0x63, //!< 'X'
+        0x07, 0x08, 0x70, 0x08, 0x07, //!< 'Y'
+        0x61, 0x51, 0x49, 0x45, 0x43, //!< 'Z'
+        0x00, 0x7F, 0x41, 0x41, 0x00, //!< '['
+        0x02, 0x04, 0x08, 0x10, 0x20, //!< '\\'
+        0x00, 0x41, 0x41, 0x7F, 0x00, //!< ']'
+        0x04, 0x02, 0x01, 0x02, 0x04, //!< '^'
+        0x40, 0x40, 0x40, 0x40, 0x40, //!< '_'
+        0x00, 0x01, 0x02, 0x04, 0x00, //!< '`'
+        0x20, 0x54, 0x54, 0x54, 0x78, //!< 'a'
+        0x7F, 0x48, 0x44, 0x44, 0x38, //!< 'b'
+        0x38, 0x44, 0x44, 0x44, 0x20, //!< 'c'
+        0x38, 0x44, 0x44, 0x48, 0x7F, //!< 'd'
+        0x38, 0x54, 0x54, 0x54, 0x18, //!< 'e'
+        0x08, 0x7E, 0x09, 0x01, 0x02, //!< 'f'
+        0x0C, 0x52, 0x52, 0x52, 0x3E, //!< 'g'
+        0x7F, 0x08, 0x04, 0x04, 0x78, //!< 'h'
+        0x00, 0x44, 0x7D, 0x40, 0x00, //!< 'i'
+        0x20, 0x40, 0x44, 0x3D, 0x00, //!< 'j'
+        0x7F, 0x10, 0x28, 0x44, 0x00, //!< 'k'
+        0x00, 0x41, 0x7F, 0x40, 0x00, //!< 'l'
+        0x7C, 0x04, 0x18, 0x04, 0x78, //!< 'm'
+        0x7C, 0x08, 0x04, 0x04, 0x78, //!< 'n'
+        0x38, 0x44, 0x44, 0x44, 0x38, //!< 'o'
+        0x7C, 0x14, 0x14, 0x14, 0x08, //!< 'p'
+        0x08, 0x14, 0x14, 0x18, 0x7C, //!< 'q'
+        0x7C, 0x08, 0x04, 0x04, 0x08, //!< 'r'
+        0x48, 0x54, 0x54, 0x54, 0x20, //!< 's'
+        0x04, 0x3F, 0x44, 0x40, 0x20, //!< 't'
+        0x3C, 0x40, 0x40, 0x20, 0x7C, //!< 'u'
+        0x1C, 0x20, 0x40, 0x20, 0x1C, //!< 'v'
+        0x3C, 0x40, 0x30, 0x40, 0x3C, //!< 'w'
+        0x44, 0x28, 0x10, 0x28, 0x44, //!< 'x'
+        0x0C, 0x50, 0x50, 0x50, 0x3C, //!< 'y'
+        0x44, 0x64, 0x54, 0x4C, 0x44, //!< 'z'
+        0x00, 0x08, 0x36, 0x41, 0x00, //!< '{'
+        0x00, 0x00, 0x7F, 0x00, 0x00, //!< '|'
+        0x00, 0x41, 0x36, 0x08, 0x00, //!< '}'
+        0x08, 0x04, 0x08, 0x10, 0x08, //!< '~'
+};
+//!< Panel set up: display off, clock, 64 line multiplex, no offset, start
+//!< line 0, charge pump on, horizontal addressing, flipped to the header
+//!< side, COM pins, contrast, precharge, VCOMH, show RAM, not inverted,
+//!< no scroll, and display on
+static const uint8_t SETUP[] PROGMEM = {
+        0xAE, 0xD5, 0x80, 0xA8, DISPLAY_HEIGHT - 1, 0xD3, 0x00, 0x40, 0x8D, 0x14,
+        0x20, 0x00, 0xA1, 0xC8, 0xDA, 0x12, 0x81, 0xCF, 0xD9, 0xF1, 0xDB, 0x40,
+        0xA4, 0xA6, 0x2E, 0xAF
+};
+
+TextDisplay::TextDisplay(uint8_t address, uint32_t clock) :
+    m_address(address),
+    m_clock(clock)
+{}
+
+/**
+ * The set up commands go out from the page's columns, in the background
+ */
+void TextDisplay::begin() {
+    Twi::begin(m_clock);
+    memcpy_P(m_columns, SETUP, sizeof(SETUP));
+    Twi::send(m_address, DISPLAY_COMMANDS, m_columns, sizeof(SETUP));
+}
+
+bool TextDisplay::idle() const {
+    return Twi::idle();
+}
+/**
+ * Address the window of the page, then send its columns. The panel is in
+ * horizontal addressing, so data fills the addressed window.
+ */
+bool TextDisplay::draw(uint8_t page, uint8_t first, uint8_t last, const char* text,
+                       uint8_t size, uint8_t band) {
+    if (!idle()) {
+        return false;
+    }
+    uint8_t length = strlen(text);
+    m_commands[0] = DISPLAY_PAGE_ADDRESS;
+    m_commands[1] = page;
+    m_commands[2] = page;
+    m_commands[3] = DISPLAY_COLUMN_ADDRESS;
+    m_commands[4] = first;
+    m_commands[5] = last;
+    for (uint16_t column = first; column <= last; column++) {
+        m_columns[column - first] = pixels(text, length, size, band, column);
+    }
+    Twi::send(m_address, DISPLAY_COMMANDS, m_commands, DISPLAY_ADDRESSING);
+    Twi::send(m_address, DISPLAY_DATA, m_columns, last + 1 - first);
+    return true;
+}
+/**
+ * Set up: a dummy byte, the pages and interval, then two more dummy bytes
+ */
+bool TextDisplay::scroll(uint8_t first, uint8_t last) {
+    if (!idle()) {
+        return false;
+    }
+    m_commands[0] = DISPLAY_SCROLL_LEFT;
+    m_commands[1] = 0x00;
+    m_commands[2] = first;
+    m_commands[3] = DISPLAY_SCROLL_INTERVAL;
+    m_commands[4] = last;
+    m_commands[5] = 0x00;
+    m_commands[6] = 0xFF;
+    m_commands[7] = DISPLAY_SCROLL_START;
+    Twi::send(m_address, DISPLAY_COMMANDS, m_commands, DISPLAY_SCROLLING);
+    return true;
+}
+
+bool TextDisplay::stop() {
+    if (!idle()) {
+        return false;
+    }
+    m_commands[0] = DISPLAY_SCROLL_STOP;
+    Twi::send(m_address, DISPLAY_COMMANDS, m_commands, 1);
+    return true;
+}
+/**
+ * Size 2 takes the band's half of the glyph column, and doubles each of its
+ * pixels down the page
+ */
+uint8_t TextDisplay::pixels(const char* text, uint8_t length, uint8_t size,
+                            uint8_t band, uint8_t column) {
+    uint8_t width = DISPLAY_CHAR_WIDTH * size;
+    uint8_t index = column / width;
+    uint8_t offset = (column % width) / size;
+    if (index >= length || offset >= DISPLAY_GLYPH_WIDTH) {
+        return 0;
+    }
+    char character = text[index];
+    if (character < DISPLAY_FONT_FIRST || character > DISPLAY_FONT_LAST) {
+        return 0;
+    }
+    uint8_t bits = pgm_read_byte(FONT + (character - DISPLAY_FONT_FIRST) * DISPLAY_GLYPH_WIDTH + offset);
+    if (size == 1) {
+        return bits;
+    }
+    bits = (band == 0) ? (bits & 0x0F) : (bits >> 4);
+    uint8_t doubled = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (bits & (1 << i)) {
+            doubled |= 0x03 << (2 * i);
+        }
+    }
+    return doubled;
+}
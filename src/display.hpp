@@ -0,0 +1,112 @@
+/*
+ * display.hpp:
+ *
+ * Framebuffer-free text driver for the SSD1306 OLED panel. The panel's own
+ * display RAM is the only copy of the picture. Text is drawn by streaming the
+ * columns of its glyphs, read from a 5x7 font in PROGMEM, straight to a window
+ * of a page (an 8 pixel high band) of the panel. Size 1 characters are 6x8
+ * pixels, a page high. Size 2 characters are scaled to 12x16, across two
+ * pages, each page drawn on its own from the upper or lower half (band) of
+ * the glyph.
+ *
+ * The caller keeps the text, and draws each page that changes with the text
+ * over it. Compared to a 1KB framebuffer for the 128x64 panel, this needs no
+ * RAM beyond a page. Pages are sent in the background by the TWI engine, one
+ * at a time: a draw fills the page, queues it, and returns.
+ *
+ * Pages can also be scrolled left by the panel itself, a column every few
+ * frames, wrapping round, with no work on this side until stopped. Scrolling
+ * moves the panel's RAM, so scrolled pages must be drawn whole once stopped,
+ * and nothing should be drawn while scrolling.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_DISPLAY_HPP_
+#define SRC_DISPLAY_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+#include "twi.hpp"
+//!< Panel size in pixels, and pages
+#define DISPLAY_WIDTH 128
+#define DISPLAY_HEIGHT 64
+#define DISPLAY_PAGES (DISPLAY_HEIGHT / 8)
+//!< Width of a size 1 character, its glyph, and a column of space
+#define DISPLAY_CHAR_WIDTH 6
+//!< Width of a glyph in the font
+#define DISPLAY_GLYPH_WIDTH 5
+//!< Longest command sequence sent: scroll set up and start
+#define DISPLAY_COMMAND_MAX 8
+//!< Scroll interval code, and the frames it means: a column every 2 frames
+#define DISPLAY_SCROLL_INTERVAL 0x07
+#define DISPLAY_SCROLL_FRAMES 2
+//!< Nominal frame rate of the panel. It varies by panel and temperature.
+#define DISPLAY_FRAME_HZ 100
+//!< Time for a scroll to turn a page once round, nominally
+#define DISPLAY_SCROLL_TURN_MS \
+    ((static_cast<uint32_t>(DISPLAY_WIDTH) * DISPLAY_SCROLL_FRAMES * 1000) / DISPLAY_FRAME_HZ)
+
+class TextDisplay {
+    public:
+        /**
+         * Construct the driver. The panel is set up in begin.
+         * \param uint8_t address: I2C address of the panel
+         * \param uint32_t clock: I2C clock in Hz
+         */
+        TextDisplay(uint8_t address, uint32_t clock);
+        /**
+         * Start the I2C bus at the clock, and queue setting the panel up with
+         * its charge pump on. Returns at once; the panel's RAM is left as it
+         * was, for the caller to clear by drawing.
+         */
+        void begin();
+        /**
+         * Is the last page drawn sent, such that another may be drawn.
+         */
+        bool idle() const;
+        /**
+         * Draw columns of one page of a text row, once idle.
+         * \param uint8_t page: page, from 0 at the top
+         * \param uint8_t first: first column to draw
+         * \param uint8_t last: last column to draw, not before first
+         * \param const char* text: text of the row, blank past its end
+         * \param uint8_t size: text size, 1 or 2
+         * \param uint8_t band: page of the row to draw, 0 for its top
+         * \return true if queued, false if not idle
+         */
+        bool draw(uint8_t page, uint8_t first, uint8_t last, const char* text,
+                  uint8_t size, uint8_t band);
+        /**
+         * Start the panel scrolling pages left, once idle.
+         * \param uint8_t first: first page to scroll
+         * \param uint8_t last: last page to scroll
+         * \return true if queued, false if not idle
+         */
+        bool scroll(uint8_t first, uint8_t last);
+        /**
+         * Stop the panel scrolling, once idle. Scrolled pages are left
+         * shifted, and must be drawn again.
+         * \return true if queued, false if not idle
+         */
+        bool stop();
+    private:
+        /**
+         * Pixel column of a page of a text row.
+         * \param const char* text: text of the row
+         * \param uint8_t length: length of the text
+         * \param uint8_t size: text size, 1 or 2
+         * \param uint8_t band: page of the row
+         * \param uint8_t column: column across the panel
+         * \return column's pixels, least significant bit at the top
+         */
+        static uint8_t pixels(const char* text, uint8_t length, uint8_t size,
+                              uint8_t band, uint8_t column);
+        //!< I2C address of the panel
+        uint8_t m_address;
+        //!< I2C clock in Hz
+        uint32_t m_clock;
+        //!< Addressing commands and columns of the page being sent
+        uint8_t m_commands[DISPLAY_COMMAND_MAX];
+        uint8_t m_columns[DISPLAY_WIDTH];
+};
+#endif /* SRC_DISPLAY_HPP_ */
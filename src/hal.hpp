@@ -0,0 +1,86 @@
+/*
+ * hal.hpp:
+ *
+ * Hardware abstraction layer. Firmware code includes this header in place of
+ * the Arduino headers, and names its serial ports through the types below.
+ * On the board this pulls in the Arduino core and libraries. On the native
+ * build it pulls in the simulator (lib/sim), which supplies the same calls
+ * against simulated pins, a virtual clock, in-memory serial ports, and an I2C
+ * bus with the OLED panel on it, and the EEPROM, such that the firmware builds
+ * and runs on a Linux host.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_HAL_HPP_
+#define SRC_HAL_HPP_
+//!< Highest baud of the matrix link, limited by the SoftUart's timer interrupt rate
+#define MATRIX_MAX_BAUD 19200
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <avr/eeprom.h>
+#include "hostuart.hpp"
+#include "softuart.hpp"
+//!< Serial link to the host box
+typedef HostUart HostSerial;
+//!< Host port instance
+#define HOST_PORT Host
+//!< Serial link to the matrix switch
+typedef SoftUart MatrixSerial;
+static_assert(MATRIX_MAX_BAUD == SOFT_UART_MAX_BAUD, "Matrix link limit must match the SoftUart");
+/**
+ * Enable the pin change interrupt of a pin. The vectors are fixed on the
+ * board, and defined by their user, so the handler is not used here.
+ * \param uint8_t pin: pin to watch
+ * \param void (*isr)(void): handler the vectors call
+ */
+inline void pin_change_attach(uint8_t pin, void (*isr)(void)) {
+    (void) isr;
+    uint8_t sreg = SREG;
+    cli();
+    *digitalPinToPCMSK(pin) |= _BV(digitalPinToPCMSKbit(pin));
+    PCICR |= _BV(digitalPinToPCICRbit(pin));
+    SREG = sreg;
+}
+#else
+#include <sim.hpp>
+//!< Serial link to the host box
+typedef SimSerial HostSerial;
+//!< Host port instance
+#define HOST_PORT Serial
+/**
+ * SimMatrixSerial:
+ *
+ * Simulated matrix port. As the SoftUart it stands in for, it clamps its baud
+ * to MATRIX_MAX_BAUD, such that the simulated link is no faster than the
+ * board's.
+ */
+class SimMatrixSerial : public SimSerial {
+    public:
+        /**
+         * Construct the port.
+         * \param uint8_t rx: receive pin
+         * \param uint8_t tx: transmit pin
+         * \param bool blocking: writes stall the clock for their byte-time
+         */
+        SimMatrixSerial(uint8_t rx, uint8_t tx, bool blocking = false) : SimSerial(rx, tx, blocking) {}
+        /**
+         * Start the port at a baud, clamped to MATRIX_MAX_BAUD.
+         * \param unsigned long baud: baud rate
+         */
+        void begin(unsigned long baud) {
+            SimSerial::begin((baud > MATRIX_MAX_BAUD) ? MATRIX_MAX_BAUD : baud);
+        }
+};
+//!< Serial link to the matrix switch
+typedef SimMatrixSerial MatrixSerial;
+/**
+ * Enable the pin change interrupt of a pin.
+ * \param uint8_t pin: pin to watch
+ * \param void (*isr)(void): handler called on any change of the pin
+ */
+inline void pin_change_attach(uint8_t pin, void (*isr)(void)) {
+    attachPinChange(pin, isr);
+}
+#endif
+#endif /* SRC_HAL_HPP_ */
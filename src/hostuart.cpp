@@ -0,0 +1,120 @@
+/*
+ * hostuart.cpp:
+ *
+ * Interrupt-driven USART0 implementations. Board only.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifdef ARDUINO
+#include "hostuart.hpp"
+//!< Ring buffer index mask
+#define HOST_UART_MASK (HOST_UART_BUFFER - 1)
+
+HostUart Host;
+
+ISR(USART_RX_vect) {
+    Host.receive();
+}
+ISR(USART_UDRE_vect) {
+    Host.transmit();
+}
+HostUart::HostUart() :
+    m_overflow(0),
+    m_receiver(NULL),
+    m_rx_head(0),
+    m_rx_tail(0),
+    m_tx_head(0),
+    m_tx_tail(0)
+{}
+/**
+ * Double speed mode, as HardwareSerial, for the closer baud match
+ */
+void HostUart::begin(unsigned long baud) {
+    UCSR0A = _BV(U2X0);
+    UBRR0 = (F_CPU / 4 / baud - 1) / 2;
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+void HostUart::set_receiver(SerialReceiver receiver) {
+    uint8_t sreg = SREG;
+    cli();
+    m_receiver = receiver;
+    SREG = sreg;
+}
+int HostUart::available() {
+    return (m_rx_head - m_rx_tail) & HOST_UART_MASK;
+}
+int HostUart::availableForWrite() {
+    return HOST_UART_MASK - ((m_tx_head - m_tx_tail) & HOST_UART_MASK);
+}
+int HostUart::read() {
+    if (m_rx_head == m_rx_tail) {
+        return -1;
+    }
+    uint8_t byte = m_rx_buffer[m_rx_tail];
+    m_rx_tail = (m_rx_tail + 1) & HOST_UART_MASK;
+    return byte;
+}
+int HostUart::peek() {
+    return (m_rx_head == m_rx_tail) ? -1 : m_rx_buffer[m_rx_tail];
+}
+/**
+ * Queue the byte, with interrupts held off around each attempt, as interrupt
+ * handlers may push too. With interrupts off, poll the data register, as
+ * HardwareSerial does, rather than waiting forever on a full buffer.
+ */
+size_t HostUart::write(uint8_t byte) {
+    bool queued = false;
+    while (!queued) {
+        uint8_t sreg = SREG;
+        cli();
+        queued = push(byte);
+        SREG = sreg;
+        if (!queued && bit_is_clear(SREG, SREG_I) && bit_is_set(UCSR0A, UDRE0)) {
+            transmit();
+        }
+    }
+    return 1;
+}
+/**
+ * Queue the byte and enable the data register empty interrupt
+ */
+bool HostUart::push(uint8_t byte) {
+    uint8_t next = (m_tx_head + 1) & HOST_UART_MASK;
+    if (next == m_tx_tail) {
+        return false;
+    }
+    m_tx_buffer[m_tx_head] = byte;
+    m_tx_head = next;
+    UCSR0B |= _BV(UDRIE0);
+    return true;
+}
+/**
+ * Offer the byte to the receiver only when nothing is buffered ahead of it
+ */
+void HostUart::receive() {
+    uint8_t byte = UDR0;
+    if (m_rx_head == m_rx_tail && m_receiver != NULL && m_receiver(byte)) {
+        return;
+    }
+    uint8_t next = (m_rx_head + 1) & HOST_UART_MASK;
+    if (next != m_rx_tail) {
+        m_rx_buffer[m_rx_head] = byte;
+        m_rx_head = next;
+    } else {
+        m_overflow++;
+    }
+}
+void HostUart::transmit() {
+    if (m_tx_head == m_tx_tail) {
+        UCSR0B &= ~_BV(UDRIE0);
+        return;
+    }
+    UDR0 = m_tx_buffer[m_tx_tail];
+    m_tx_tail = (m_tx_tail + 1) & HOST_UART_MASK;
+    if (m_tx_head == m_tx_tail) {
+        UCSR0B &= ~_BV(UDRIE0);
+    }
+}
+#endif
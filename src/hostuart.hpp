@@ -0,0 +1,99 @@
+/*
+ * hostuart.hpp:
+ *
+ * Interrupt-driven USART0 driver for the host link. This replaces the Arduino
+ * core's HardwareSerial, which buffers every received byte for the main loop.
+ * Here a receiver function may take each byte straight from the receive
+ * interrupt, such that passthrough bytes are forwarded without waiting on the
+ * runners. Bytes the receiver refuses, and all bytes after them, are buffered
+ * for the main loop as usual. This keeps the byte order whichever side takes
+ * them.
+ *
+ * Only one instance exists: Host, in place of Serial. Serial must not be used,
+ * or the core's USART0 interrupts would be linked in as well.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_HOSTUART_HPP_
+#define SRC_HOSTUART_HPP_
+#include <Arduino.h>
+#include "types.hpp"
+//!< Ring buffer sizes, must be a power of two
+#define HOST_UART_BUFFER 128
+
+class HostUart : public Print {
+    public:
+        /**
+         * Construct the UART. Hardware is set up in begin.
+         */
+        HostUart();
+        /**
+         * Set up USART0 for 8N1 at the baud rate, and enable its interrupts.
+         * \param unsigned long baud: baud rate
+         */
+        void begin(unsigned long baud);
+        /**
+         * Register the receiver offered each byte from the receive interrupt.
+         * It runs in interrupt context, and must be fast.
+         * \param SerialReceiver receiver: receiver, or NULL to buffer all bytes
+         */
+        void set_receiver(SerialReceiver receiver);
+        /**
+         * Bytes waiting in the receive buffer.
+         */
+        int available();
+        /**
+         * Space left in the transmit buffer.
+         */
+        int availableForWrite();
+        /**
+         * Read a buffered byte.
+         * \return byte, or -1 if none
+         */
+        int read();
+        /**
+         * Look at the next buffered byte, without taking it.
+         * \return byte, or -1 if none
+         */
+        int peek();
+        /**
+         * Queue a byte to send, waiting for space when the buffer is full.
+         * \param uint8_t byte: byte to send
+         * \return 1
+         */
+        size_t write(uint8_t byte);
+        using Print::write;
+        /**
+         * Queue a byte to send without waiting. Safe in interrupt context, or
+         * with interrupts off.
+         * \param uint8_t byte: byte to send
+         * \return true if queued, false when the transmit buffer is full
+         */
+        bool push(uint8_t byte);
+        /**
+         * Receive complete handler. Called from the USART0 interrupt.
+         */
+        void receive();
+        /**
+         * Data register empty handler: sends the next queued byte. Called
+         * from the USART0 interrupt, or polled when interrupts are off.
+         */
+        void transmit();
+        //!< Bytes lost on a full receive buffer
+        volatile uint8_t m_overflow;
+    private:
+        //!< Receiver taking bytes in the interrupt
+        SerialReceiver m_receiver;
+        //!< Receive ring buffer, written by receive, read by read
+        uint8_t m_rx_buffer[HOST_UART_BUFFER];
+        volatile uint8_t m_rx_head;
+        volatile uint8_t m_rx_tail;
+        //!< Transmit ring buffer, written by write, read by transmit
+        uint8_t m_tx_buffer[HOST_UART_BUFFER];
+        volatile uint8_t m_tx_head;
+        volatile uint8_t m_tx_tail;
+};
+//!< The host port
+extern HostUart Host;
+#endif /* SRC_HOSTUART_HPP_ */
@@ -7,25 +7,22 @@
  *      Author: lestarch
  */
 #include <string.h>
-#include <Arduino.h>
+#include "hal.hpp"
 #include "indicator.hpp"
-#include "version.hpp"
 
 //Concrete definitions for shared static members
-char Indicator::s_error_file[MAX_STR_LEN];
-char Indicator::s_error_message[MAX_STR_LEN];
+char Indicator::s_error_file[MAX_STR_LEN + 1];
+char Indicator::s_error_message[MAX_STR_LEN + 1];
 int Indicator::s_error_line = -1;
 bool Indicator::s_error_state = false;
-unsigned int Indicator::s_msg_pointer = 0;
-//!< Static, shared key storage
-char Indicator::s_key_store[MAX_MSG_COUNT][MAX_KEY_LEN + 1];
 //!< Static, shared message storage
-char Indicator::s_msg_store[MAX_MSG_COUNT][MAX_STR_LEN + 1];
+MessageStore Indicator::s_store;
 
 /**
  * Constuctor initializes the member variables of the class.
  */
-Indicator::Indicator() : Runner()
+Indicator::Indicator(uint16_t period, uint16_t phase) :
+    Runner(period, phase)
 {
     //Initialize all member arrays
     for (int i = 0; i < MAX_BUTTON; i++) {
@@ -34,12 +31,8 @@ Indicator::Indicator() : Runner()
     for (int i = 0; i < MAX_SERIAL; i++) {
         m_writing[i] = 0;
     }
-    memset(s_error_file, 0, MAX_STR_LEN);
-    memset(s_error_message, 0, MAX_STR_LEN);
-    memset(Indicator::s_key_store, 0, sizeof(Indicator::s_key_store));
-    memset(Indicator::s_msg_store, 0, sizeof(Indicator::s_msg_store));
-    strncpy(Indicator::s_key_store[MAX_MSG_COUNT - 1], "FIRM", MAX_KEY_LEN);
-    strncpy(Indicator::s_msg_store[MAX_MSG_COUNT - 1],  VERSION, MAX_STR_LEN);
+    memset(s_error_file, 0, sizeof(s_error_file));
+    memset(s_error_message, 0, sizeof(s_error_message));
 }
 
 /**
@@ -63,25 +56,20 @@ void Indicator::serial_written(SerialType serial) {
     m_writing[serial] = true;
 }
 /**
- * The default indicator action on the boot status update is to set the
- * current boot state.
- */
-void Indicator::boot_update(BootStatus status) {
-    //Bounds checking, or return
-    ASSERT(status < MAX_BOOT, "Boot status out of range");
-    m_writing[status] = true;
-}
-/**
- * The default handler for incoming messages. This will store the last N
- * messages received, and discard the rest.
+ * The default handler for incoming messages. This will store the last
+ * message received for each key, until the store runs out of room.
  */
 void Indicator::message(const char* key, const char* msg) {
-    strncpy(Indicator::s_key_store[Indicator::s_msg_pointer], key, MAX_KEY_LEN);
-    strncpy(Indicator::s_msg_store[Indicator::s_msg_pointer], msg, MAX_STR_LEN);
-    Indicator::s_key_store[Indicator::s_msg_pointer][MAX_KEY_LEN] = '\0';
-    Indicator::s_msg_store[Indicator::s_msg_pointer][MAX_STR_LEN] = '\0';
-
-    s_msg_pointer = (s_msg_pointer + 1) % (MAX_MSG_COUNT - 1); // Last slot is for firmware id
+    s_store.set(key, msg);
+}
+void Indicator::message(const char* key, const char* msg, uint8_t length) {
+    s_store.set(key, msg, length);
+}
+void Indicator::message(const char* key, StoreType type, const StoreValue& value) {
+    s_store.set(key, type, value);
+}
+const MessageStore& Indicator::store() {
+    return s_store;
 }
 /**
  * The default indicator action for errors is to set the error state and set
@@ -96,12 +84,14 @@ void Indicator::error(const char* file, const int line, const char* msg) {
         s_error_state = true;
         //Do not error in error, so check for null, don't ASSERT not-null
        if ((file != NULL) && (strncmp(s_error_file, "", MAX_STR_LEN) == 0)) {
-            //Use strncpy to avoid buffer overflows
+            //Use strncpy to avoid buffer overflows, terminating long names
             strncpy(s_error_file, file, MAX_STR_LEN);
+            s_error_file[MAX_STR_LEN] = '\0';
         }
         if ((msg != NULL) &&
           (strncmp(s_error_message, "", MAX_STR_LEN) == 0)) {
             strncpy(s_error_message, msg, MAX_STR_LEN);
+            s_error_message[MAX_STR_LEN] = '\0';
         }
         s_error_line = line;
     }
@@ -7,14 +7,19 @@
  *
  * 1. Button Pressed: called to when a button is pressed. Passed a button
  *    type indication to handle different types of buttons.
- * 2. Boot Status: called each time the boot status of the box is changed.
- *    Passed the current boot status.
- * 3. Write Byte: called when a byte is written to a serial port.
- *    Passed serial port type indicating interface written to.
+ * 2. Serial Written: called when bytes were written to a serial port, once
+ *    a batch from the passthrough's loop. Passed serial port type indicating
+ *    interface written to.
+ *
+ * Inputs arrive over the event bus (bus.hpp), which calls each indicator's
+ * handlers on its own type. The handlers are thus not virtual: a subclass
+ * handles an input by declaring a handler of the same name, hiding the
+ * default one here.
  *
  * Implementation Note: this is a rate-driven component. All updates to
  * indicators that require timed-responses should be carried out in the
- * run function. This function will be called 1 time every millisecond.
+ * run function. This function will be called once every period declared by
+ * the indicator.
  *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
@@ -23,42 +28,56 @@
 #define SRC_INDICATOR_HPP_
 #include "types.hpp"
 #include "runner.hpp"
+#include "store.hpp"
 
 class Indicator : public Runner
 {
     public:
         /**
          * Constructs the indicator.
+         * \param uint16_t period: milliseconds between calls to run
+         * \param uint16_t phase: offset of first call from schedule start
          */
-        Indicator();
+        Indicator(uint16_t period = RATE_GROUP_PERIOD, uint16_t phase = 0);
         /**
          * Called to indicate that a button was pressed.
          * Default implementation: set m_pressed for button.
          * \param ButtonType button: button pressed
          */
-        virtual void button_pressed(ButtonType button);
+        void button_pressed(ButtonType button);
 
         /**
          * Called to indicate that a serial port is being written to.
          * Default implementation: set m_writing for given port.
          * \param SerialType serial: serial port written to
          */
-        virtual void serial_written(SerialType serial);
-
-        /**
-         * Called to update the current state of the host boot.
-         * Default implementation: set the m_boot state variable.
-         * \param BootStatus status: new boot state
-         */
-        virtual void boot_update(BootStatus status);
+        void serial_written(SerialType serial);
 
         /**
          * Statically handles messages. This will allow all indicators to
-         *  share the same message information.
+         * share the same message information, one message per key.
          * \param const char* key: key assoicated with message
          * \param const char* msg: user provided message
          */
         static void message(const char* key, const char* msg);
+        /**
+         * Statically handles a counted message, which need not be terminated.
+         * \param const char* key: key assoicated with message
+         * \param const char* msg: user provided message
+         * \param uint8_t length: length of the message
+         */
+        static void message(const char* key, const char* msg, uint8_t length);
+        /**
+         * Statically handles a message already typed.
+         * \param const char* key: key assoicated with message
+         * \param StoreType type: STORE_ADDRESS or STORE_NUMBER
+         * \param const StoreValue& value: value of the message
+         */
+        static void message(const char* key, StoreType type, const StoreValue& value);
+        /**
+         * Shared message storage, for reading.
+         */
+        static const MessageStore& store();
 
         /**
          * Indicates an error happened. Allows this indicator to display the
@@ -84,19 +103,13 @@ class Indicator : public Runner
         //Note: static strings for memory optimization
         //!< Static, shared error state
         static bool s_error_state;
-        //!< Static, shared current BootStatus
-        static BootStatus s_boot;
         //!< Static, shared line number of current error
         static int s_error_line;
         //!< Static, shared current error file name
-        static char s_error_file[MAX_STR_LEN];
+        static char s_error_file[MAX_STR_LEN + 1];
         //!< Static, shared current error message
-        static char s_error_message[MAX_STR_LEN];
-        //!< Static, shared message pointer
-        static unsigned int s_msg_pointer;
-        //!< Static, shared key storage
-        static char s_key_store[MAX_MSG_COUNT][MAX_KEY_LEN + 1];
+        static char s_error_message[MAX_STR_LEN + 1];
         //!< Static, shared message storage
-        static char s_msg_store[MAX_MSG_COUNT][MAX_STR_LEN + 1];
+        static MessageStore s_store;
 };
 #endif /* SRC_INDICATOR_HPP_ */
@@ -0,0 +1,289 @@
+/*
+ * journal.cpp:
+ *
+ * Warm-start journal implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include "journal.hpp"
+#include "indicator.hpp"
+static_assert(2 * (JOURNAL_HEADER + JOURNAL_PAYLOAD_MAX + JOURNAL_TRAILER) <= JOURNAL_SIZE,
+              "Ring must hold a snapshot while writing the next");
+//!< No payload byte to keep
+#define JOURNAL_NOWHERE 0xFFFF
+
+/**
+ * Output taking a payload as it is printed: its length and CRC, or only the
+ * byte at one position, such that a snapshot can be written a byte at a time
+ * with no copy of it kept. Taking a position, bytes around it are only
+ * counted, and the output is done once past it.
+ */
+class JournalSink : public Print {
+    public:
+        JournalSink(uint16_t position) :
+            m_length(0),
+            m_crc(BINARY_CRC_INIT),
+            m_position(position),
+            m_byte(0)
+        {}
+        size_t write(uint8_t byte) {
+            if (m_position == JOURNAL_NOWHERE) {
+                m_crc = crc16(m_crc, byte);
+            } else if (m_length == m_position) {
+                m_byte = byte;
+            }
+            m_length++;
+            return 1;
+        }
+        size_t write(const uint8_t* buffer, size_t size) {
+            if (m_position != JOURNAL_NOWHERE &&
+                (m_position < m_length || static_cast<uint16_t>(m_position - m_length) >= size)) {
+                m_length += size;
+                return size;
+            }
+            return Print::write(buffer, size);
+        }
+        using Print::write;
+        /**
+         * Whether the position kept has been printed
+         */
+        bool done() const {
+            return m_position != JOURNAL_NOWHERE && m_length > m_position;
+        }
+        //!< Bytes printed, their CRC, the position kept, and its byte
+        uint16_t m_length;
+        uint16_t m_crc;
+        uint16_t m_position;
+        uint8_t m_byte;
+};
+/**
+ * EEPROM byte of the ring, wrapping round
+ */
+static uint8_t peek(uint16_t address) {
+    return eeprom_read_byte(reinterpret_cast<const uint8_t*>(address % JOURNAL_SIZE));
+}
+static void poke(uint16_t address, uint8_t byte) {
+    eeprom_write_byte(reinterpret_cast<uint8_t*>(address % JOURNAL_SIZE), byte);
+}
+/**
+ * CRC of a snapshot, from the CRC of its payload
+ */
+static uint16_t seal(uint16_t crc, uint16_t length, uint16_t sequence) {
+    crc = crc16(crc16(crc, static_cast<uint8_t>(length)), static_cast<uint8_t>(length >> 8));
+    return crc16(crc16(crc, static_cast<uint8_t>(sequence)), static_cast<uint8_t>(sequence >> 8));
+}
+
+Journal::Journal(SerialPass& pass, OLED& oled) :
+    Runner(JOURNAL_PERIOD_MS, JOURNAL_PHASE_MS),
+    m_pass(pass),
+    m_oled(oled),
+    m_saved_crc(0),
+    m_saved_length(0),
+    m_seen_crc(0),
+    m_seen_length(0),
+    m_changed_time(0),
+    m_dirty_time(0),
+    m_budget(1),
+    m_refill_time(0),
+    m_next(0),
+    m_sequence(0),
+    m_step(JOURNAL_IDLE),
+    m_crc(0)
+{}
+/**
+ * Every start holding the magic is a candidate, taken when its CRC checks
+ * out. Sequences are compared by signed difference, as they wrap. The state
+ * restored is then taken as saved, so it is not written straight back.
+ */
+void Journal::restore() {
+    uint16_t found = JOURNAL_IDLE;
+    uint16_t found_length = 0;
+    uint16_t found_sequence = 0;
+    for (uint16_t start = 0; start < JOURNAL_SIZE; start++) {
+        if (peek(start) != JOURNAL_MAGIC) {
+            continue;
+        }
+        uint16_t length = peek(start + 1) | (static_cast<uint16_t>(peek(start + 2)) << 8);
+        uint16_t sequence = peek(start + 3) | (static_cast<uint16_t>(peek(start + 4)) << 8);
+        if (length > JOURNAL_PAYLOAD_MAX ||
+            (found != JOURNAL_IDLE && static_cast<int16_t>(sequence - found_sequence) <= 0)) {
+            continue;
+        }
+        uint16_t crc = BINARY_CRC_INIT;
+        for (uint16_t i = 0; i < length; i++) {
+            crc = crc16(crc, peek(start + JOURNAL_HEADER + i));
+        }
+        uint16_t stored = (static_cast<uint16_t>(peek(start + JOURNAL_HEADER + length)) << 8) |
+                          peek(start + JOURNAL_HEADER + length + 1);
+        if (seal(crc, length, sequence) == stored) {
+            found = start;
+            found_length = length;
+            found_sequence = sequence;
+        }
+    }
+    if (found != JOURNAL_IDLE) {
+        m_next = (found + JOURNAL_HEADER + found_length + JOURNAL_TRAILER) % JOURNAL_SIZE;
+        m_sequence = found_sequence + 1;
+        uint16_t address = found + JOURNAL_HEADER;
+        uint16_t end = address + found_length;
+        if (found_length >= (3 + MATRIX_OUTPUTS) && peek(address) == JOURNAL_FORMAT) {
+            m_oled.show(peek(address + 1));
+            address += 2;
+            for (uint8_t output = 1; output <= MATRIX_OUTPUTS; output++) {
+                m_pass.restore(output, peek(address++));
+            }
+            uint8_t count = peek(address++);
+            //Each message is checked to fit the payload before it is stored
+            for (uint8_t i = 0; i < count && (address + MAX_KEY_LEN + 2) <= end; i++) {
+                char key[MAX_KEY_LEN + 1];
+                for (uint8_t j = 0; j < MAX_KEY_LEN; j++) {
+                    key[j] = static_cast<char>(peek(address++));
+                }
+                key[MAX_KEY_LEN] = '\0';
+                uint8_t type = peek(address++);
+                if (type == STORE_STRING) {
+                    char msg[MAX_STR_LEN];
+                    uint8_t length = peek(address++);
+                    if (length > MAX_STR_LEN || (address + length) > end) {
+                        break;
+                    }
+                    for (uint8_t j = 0; j < length; j++) {
+                        msg[j] = static_cast<char>(peek(address++));
+                    }
+                    Indicator::message(key, msg, length);
+                } else if ((type == STORE_ADDRESS || type == STORE_NUMBER) && (address + 4) <= end) {
+                    StoreValue value;
+                    uint32_t number = 0;
+                    for (uint8_t j = 0; j < 4; j++) {
+                        value.address[j] = peek(address + j);
+                        number |= static_cast<uint32_t>(peek(address + j)) << (8 * j);
+                    }
+                    address += 4;
+                    if (type == STORE_NUMBER) {
+                        value.number = static_cast<int32_t>(number);
+                    }
+                    Indicator::message(key, static_cast<StoreType>(type), value);
+                } else {
+                    break;
+                }
+            }
+        }
+    }
+    JournalSink sink(JOURNAL_NOWHERE);
+    snapshot(sink);
+    m_saved_crc = m_seen_crc = sink.m_crc;
+    m_saved_length = m_seen_length = sink.m_length;
+    m_changed_time = m_dirty_time = m_refill_time = millis();
+    m_budget = 1;
+}
+void Journal::run() {
+    if (m_step != JOURNAL_IDLE) {
+        write();
+    } else if (Runner::interval_check(JOURNAL_CHECK_MS)) {
+        check();
+    }
+}
+/**
+ * Format, message shown, the input of each output, then each message as its
+ * packed key, its type, and its value as kept. Messages past the position
+ * kept are left off.
+ */
+void Journal::snapshot(JournalSink& out) const {
+    const MessageStore& store = Indicator::store();
+    out.write(static_cast<uint8_t>(JOURNAL_FORMAT));
+    out.write(m_oled.shown());
+    for (uint8_t output = 1; output <= MATRIX_OUTPUTS; output++) {
+        out.write(m_pass.target(output));
+    }
+    out.write(store.stored());
+    for (uint8_t i = 0; i < store.stored() && !out.done(); i++) {
+        const StoreEntry& entry = store.entry(i);
+        for (uint8_t j = 0; j < MAX_KEY_LEN; j++) {
+            out.write(static_cast<uint8_t>(entry.key >> (8 * j)));
+        }
+        out.write(entry.type);
+        if (entry.type == STORE_STRING) {
+            out.write(entry.value.text.length);
+            out.write(reinterpret_cast<const uint8_t*>(store.text(entry)), entry.value.text.length);
+        } else if (entry.type == STORE_ADDRESS) {
+            out.write(entry.value.address, 4);
+        } else {
+            for (uint8_t j = 0; j < 4; j++) {
+                out.write(static_cast<uint8_t>(static_cast<uint32_t>(entry.value.number) >> (8 * j)));
+            }
+        }
+    }
+}
+/**
+ * Times are kept in full, as the interval outlasts 16 bit milliseconds. The
+ * state is dirty from its first change after it was saved. A full budget
+ * does not bank time toward the next refill.
+ */
+void Journal::check() {
+    JournalSink sink(JOURNAL_NOWHERE);
+    snapshot(sink);
+    uint32_t now = millis();
+    if (m_budget >= JOURNAL_BUDGET) {
+        m_refill_time = now;
+    } else if ((now - m_refill_time) >= JOURNAL_INTERVAL_MS) {
+        m_budget++;
+        m_refill_time += JOURNAL_INTERVAL_MS;
+    }
+    bool saved = (m_seen_crc == m_saved_crc && m_seen_length == m_saved_length);
+    if (sink.m_crc != m_seen_crc || sink.m_length != m_seen_length) {
+        m_dirty_time = saved ? now : m_dirty_time;
+        m_seen_crc = sink.m_crc;
+        m_seen_length = sink.m_length;
+        m_changed_time = now;
+        saved = (m_seen_crc == m_saved_crc && m_seen_length == m_saved_length);
+    }
+    //State that never settles is still written, once it has waited out the
+    //interval
+    if (saved || m_budget == 0 ||
+        ((now - m_changed_time) < JOURNAL_SETTLE_MS && (now - m_dirty_time) < JOURNAL_INTERVAL_MS)) {
+        return;
+    }
+    m_budget--;
+    m_step = 0;
+    m_crc = BINARY_CRC_INIT;
+}
+/**
+ * Steps: clear the magic, the length and sequence, each payload byte, the
+ * CRC, then commit with the magic. The payload written is checked against
+ * the state that started the snapshot before it is committed.
+ */
+void Journal::write() {
+    if (!eeprom_is_ready()) {
+        return;
+    }
+    uint16_t length = m_seen_length;
+    uint16_t payload = m_step - JOURNAL_HEADER;
+    uint16_t crc = seal(m_crc, length, m_sequence);
+    if (m_step == 0) {
+        poke(m_next, 0);
+    } else if (m_step < JOURNAL_HEADER) {
+        uint16_t field = (m_step < 3) ? length : m_sequence;
+        poke(m_next + m_step, static_cast<uint8_t>(field >> ((m_step % 2 == 0) ? 8 : 0)));
+    } else if (payload < length) {
+        JournalSink sink(payload);
+        snapshot(sink);
+        poke(m_next + m_step, sink.m_byte);
+        m_crc = crc16(m_crc, sink.m_byte);
+    } else if (payload == length && m_crc != m_seen_crc) {
+        //Changed while written, given up until it settles again
+        m_step = JOURNAL_IDLE;
+        return;
+    } else if (payload < length + JOURNAL_TRAILER) {
+        poke(m_next + m_step, static_cast<uint8_t>((payload == length) ? (crc >> 8) : crc));
+    } else {
+        poke(m_next, JOURNAL_MAGIC);
+        m_saved_crc = m_seen_crc;
+        m_saved_length = length;
+        m_next = (m_next + JOURNAL_HEADER + length + JOURNAL_TRAILER) % JOURNAL_SIZE;
+        m_sequence++;
+        m_step = JOURNAL_IDLE;
+        return;
+    }
+    m_step++;
+}
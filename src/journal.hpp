@@ -0,0 +1,145 @@
+/*
+ * journal.hpp:
+ *
+ * Warm-start journal. The state the host and the buttons build up (the stored
+ * messages, the routing of the matrix, and the message shown) is kept in
+ * EEPROM, and restored at boot before the passthrough starts, so the switch
+ * comes back showing what it showed without waiting on the host.
+ *
+ * The EEPROM is a ring of snapshots of that state. Each new snapshot is
+ * written just past the last one, wrapping round, such that every byte wears
+ * alike, and the last snapshot is never overwritten while the next is being
+ * written. A snapshot is:
+ *
+ *   JOURNAL_MAGIC, length (2), sequence (2), payload (length), CRC (2)
+ *
+ * The CRC is CRC-16/CCITT-FALSE over the payload, then the length and the
+ * sequence. Multi-byte fields are little endian, but for the CRC, high byte
+ * first. The magic byte is written last, committing the snapshot; it is
+ * cleared first, such that a snapshot cut short by a reset is never taken.
+ * At boot the whole ring is scanned, and the valid snapshot of the highest
+ * sequence is restored.
+ *
+ * Snapshots are written lazily. The state is checked every JOURNAL_CHECK_MS
+ * by its CRC, and written only once it differs from the last snapshot and
+ * has settled for JOURNAL_SETTLE_MS, so a burst of changes makes a single
+ * snapshot. State that keeps changing is written once it has been changing
+ * for JOURNAL_INTERVAL_MS. Writing is one byte a run, each taking the
+ * EEPROM's ~3.4ms in the background. A snapshot whose state changed while it
+ * was being written is given up, and written again once the state settles.
+ *
+ * Each snapshot spends one from a budget of JOURNAL_BUDGET, which refills by
+ * one each JOURNAL_INTERVAL_MS. The budget starts at one at boot, such that
+ * the first change after a reset, or after a quiet spell, is written as soon
+ * as it settles, while state that keeps changing is written at most once each
+ * interval.
+ *
+ * The interval bounds the wear. The EEPROM is rated for 100,000 writes a
+ * byte. Each lap of the ring writes each byte once, and the start of each
+ * snapshot twice, its magic. The longest snapshot, JOURNAL_PAYLOAD_MAX plus 7
+ * bytes, is 320 bytes, so a lap of the 1KB ring holds at least 3 snapshots,
+ * and no byte is written more than twice in 3 snapshots. That is 150,000
+ * snapshots, or at one each 10 minutes, about 2.8 years of state that never
+ * stops changing; the budget only moves writes earlier, not more of them. A
+ * few short messages, ~60 byte snapshots, make 17 snapshots a lap, and some
+ * decades. State that does not change is never written, so resets alone
+ * cost nothing; a reset each with a change costs one snapshot.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_JOURNAL_HPP_
+#define SRC_JOURNAL_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+#include "runner.hpp"
+#include "serial.hpp"
+#include "oled.hpp"
+//!< Period of the journal, at most one EEPROM byte written each
+#define JOURNAL_PERIOD_MS 5
+//!< Offset of the journal's runs from the schedule start
+#define JOURNAL_PHASE_MS 1
+//!< Interval between checks of the state for changes
+#define JOURNAL_CHECK_MS 500
+//!< Time the state must stay unchanged before it is written
+#define JOURNAL_SETTLE_MS 2000
+//!< Time to refill one snapshot of the budget, bounding the EEPROM's wear,
+//!< see above
+#define JOURNAL_INTERVAL_MS 600000UL
+//!< Most snapshots that may be written back to back, after a quiet spell
+#define JOURNAL_BUDGET 3
+//!< Bytes of EEPROM in the ring
+#define JOURNAL_SIZE (E2END + 1)
+//!< First byte of a committed snapshot
+#define JOURNAL_MAGIC 0xA5
+//!< Layout of the payload, restored only when it matches
+#define JOURNAL_FORMAT 1
+//!< Snapshot bytes before the payload: magic, length, and sequence
+#define JOURNAL_HEADER 5
+//!< Snapshot bytes after the payload: CRC
+#define JOURNAL_TRAILER 2
+//!< Longest payload: format, message shown, routes, count, and each message
+//!< as a key, type, and value, strings at most the arena and a length each
+#define JOURNAL_PAYLOAD_MAX (3 + MATRIX_OUTPUTS + STORE_ENTRIES * (MAX_KEY_LEN + 5) + STORE_ARENA)
+//!< No snapshot being written
+#define JOURNAL_IDLE 0xFFFF
+//!< Output taking a snapshot's payload
+class JournalSink;
+
+class Journal : public Runner {
+    public:
+        /**
+         * Construct the journal over the state it keeps.
+         * \param SerialPass& pass: passthrough keeping the routing
+         * \param OLED& oled: screen keeping the message shown
+         */
+        Journal(SerialPass& pass, OLED& oled);
+        /**
+         * Restore the last snapshot, if any. Called from setup, before the
+         * passthrough starts.
+         */
+        void restore();
+        /**
+         * Check the state for changes, or write the next byte of a snapshot.
+         */
+        void run();
+    private:
+        /**
+         * Print the payload of a snapshot of the current state.
+         * \param JournalSink& out: output to print to
+         */
+        void snapshot(JournalSink& out) const;
+        /**
+         * Check the state, and start a snapshot once it has changed and
+         * settled.
+         */
+        void check();
+        /**
+         * Write the next byte of the snapshot being written.
+         */
+        void write();
+        //!< Passthrough and screen keeping the state
+        SerialPass& m_pass;
+        OLED& m_oled;
+        //!< CRC and length of the payload last written, or restored
+        uint16_t m_saved_crc;
+        uint16_t m_saved_length;
+        //!< CRC and length of the payload last checked, when it last changed,
+        //!< and when it first changed from the last saved
+        uint16_t m_seen_crc;
+        uint16_t m_seen_length;
+        uint32_t m_changed_time;
+        uint32_t m_dirty_time;
+        //!< Snapshots that may be written now, and when the budget last
+        //!< refilled
+        uint8_t m_budget;
+        uint32_t m_refill_time;
+        //!< Start of the next snapshot, and its sequence
+        uint16_t m_next;
+        uint16_t m_sequence;
+        //!< Next snapshot byte to write, or JOURNAL_IDLE, and the CRC of the
+        //!< payload bytes written so far
+        uint16_t m_step;
+        uint16_t m_crc;
+};
+#endif /* SRC_JOURNAL_HPP_ */
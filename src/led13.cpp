@@ -6,31 +6,71 @@
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
-#include <Arduino.h>
+#include "hal.hpp"
 #include "led13.hpp"
+//Initialize static pointer
+LED13Base* LED13Base::s_timed = NULL;
 /**
- * Sets-up and wraps onboard LED.
+ * Start-up reporting error. The pin is set up by LED13.
  */
-LED13::LED13(int pin) : Indicator(),
-    m_pin(pin),
-    m_state(HIGH)
-{
-    pinMode(m_pin, OUTPUT);
-    //Start-up reporting error. Once running the system will blink
-    digitalWrite(m_pin, m_state);
+LED13Base::LED13Base(bool timed) : Indicator(LED13_PERIOD_MS, LED13_PHASE_MS),
+    m_state(HIGH),
+    m_timed(timed),
+    m_blink(false),
+    m_blink_ms(0)
+{}
+/**
+ * Without room on the Ticker, the LED blinks from run instead
+ */
+bool LED13Base::setup() {
+    if (m_timed) {
+        s_timed = this;
+        m_timed = Ticker::attach(LED13Base::tick);
+    }
+    return true;
 }
 /**
  * Run function will change LED state every 100ms, resulting in 5 blinks
  * per second. If the system enters error state, then the LED is held on.
+ * Otherwise the LED flickers on for a period after serial activity.
  */
-void LED13::run() {
+void LED13Base::run() {
     //Handle error case
     if (!s_error_state) {
-        m_state = LOW;
+        bool active = false;
+        for (int i = 0; i < MAX_SERIAL; i++) {
+            active = active || m_writing[i];
+            m_writing[i] = false;
+        }
+        noInterrupts();
+        m_blink = false;
+        m_state = active ? HIGH : LOW;
+        write(m_state);
+        interrupts();
+    }
+    //Timer interrupt blinks the LED
+    else if (m_timed) {
+        m_blink = true;
     }
     //Handle normal operation
-    else if (Runner::interval_check(SWITCH_PERIOD_MS)) {
-        m_state = !m_state;
+    else {
+        if (Runner::interval_check(SWITCH_PERIOD_MS)) {
+            m_state = !m_state;
+        }
+        write(m_state);
+    }
+}
+/**
+ * Blink time is kept while off, such that blinks stay on the period
+ */
+void LED13Base::tick(uint8_t ms) {
+    LED13Base* led = s_timed;
+    led->m_blink_ms += ms;
+    if (led->m_blink_ms >= SWITCH_PERIOD_MS) {
+        led->m_blink_ms -= SWITCH_PERIOD_MS;
+        if (led->m_blink) {
+            led->m_state = !led->m_state;
+            led->write(led->m_state);
+        }
     }
-    digitalWrite(m_pin, m_state);
 }
@@ -2,9 +2,14 @@
  * led13.hpp:
  *
  * A use of the onboard LED as an indicator. This will simply blink the onboard
- * LED in case of error and will hold the LED solid-low in case of power on.
- * This acts as a fail-safe indicator, if the other indicators fail or are not
- * installed.
+ * LED in case of error and will hold the LED solid-low in case of power on,
+ * flickering on with serial activity. This acts as a fail-safe indicator, if
+ * the other indicators fail or are not installed.
+ *
+ * LED13<PIN> drives its pin through Pin<PIN>, resolved at compile time.
+ *
+ * When timed, the blink is toggled from the Ticker interrupt, such that it
+ * keeps time under load, and run only turns it on and off.
  *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
@@ -12,23 +17,74 @@
 #ifndef SRC_LED13_HPP_
 #define SRC_LED13_HPP_
 #include "indicator.hpp"
+#include "pin.hpp"
+#include "ticker.hpp"
+//!< Blink period of the LED in error state
 #define SWITCH_PERIOD_MS 100
-class LED13 : public Indicator {
+//!< Run period of the LED, matches the blink
+#define LED13_PERIOD_MS SWITCH_PERIOD_MS
+//!< Run phase of the LED, keeps it off the button releases
+#define LED13_PHASE_MS 7
+class LED13Base : public Indicator {
     public:
         /**
-         * Construct the LED13. Pass in the on-board pin. This is always
-         * pin 13, but for transparency, this should be passed in.
+         * Construct the LED13, starting on.
+         * \param bool timed: blink from the timer interrupt
+         */
+        LED13Base(bool timed);
+
+        /**
+         * Attach the blink to the Ticker, when timed. Only one LED13 may be
+         * timed.
+         * \return true
          */
-        LED13(int pin);
+        bool setup();
 
         /**
-         * Run function called every N milliseconds.
+         * Run function called every LED13_PERIOD_MS milliseconds.
          */
         void run();
+
+        /**
+         * Ticker handler toggling the blink of the timed LED13.
+         * \param uint8_t ms: milliseconds passed
+         */
+        static void tick(uint8_t ms);
     protected:
-        //!< Pin used for onboard LED, stored locally
-        int m_pin;
+        /**
+         * Drive the LED.
+         * \param bool on: light the LED
+         */
+        virtual void write(bool on) = 0;
         //!< State of the LED
         int m_state;
+        //!< Blinking from the timer interrupt
+        bool m_timed;
+        //!< Blink is on, and time into the blink period, for the interrupt
+        volatile bool m_blink;
+        uint8_t m_blink_ms;
+        //!< Timed LED13
+        static LED13Base* s_timed;
+};
+/**
+ * LED13 on its pin. This is always pin 13, but for transparency, this should
+ * be passed in.
+ */
+template <uint8_t PIN>
+class LED13 : public LED13Base {
+    public:
+        /**
+         * Sets up the pin, and lights the LED: start-up reports an error.
+         * Once running the system will blink.
+         * \param bool timed: blink from the timer interrupt
+         */
+        LED13(bool timed = false) : LED13Base(timed) {
+            Pin<PIN>::output();
+            write(m_state);
+        }
+    protected:
+        void write(bool on) {
+            Pin<PIN>::write(on);
+        }
 };
 #endif /* SRC_LED13_HPP_ */
@@ -6,17 +6,19 @@
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
-#include <Arduino.h>
-#include <SoftwareSerial.h>
 #include <string.h>
+#include "hal.hpp"
 #include "types.hpp"
 #include "button.hpp"
 #include "runner.hpp"
 #include "indicator.hpp"
+#include "bus.hpp"
 #include "led13.hpp"
 #include "rgb.hpp"
 #include "oled.hpp"
 #include "serial.hpp"
+#include "boot.hpp"
+#include "journal.hpp"
 
 //!< Debounce Interval for HDMI
 #define HDMI_DEBOUNCE_INTERVAL_MS 3000
@@ -30,48 +32,55 @@
 #define BUTTON_HDMI_PIN 2
 //!< OLED display button
 #define BUTTON_DISPLAY_PIN 7
-//!< Start-up time for the system
-#define STARUP_TIME_MS 5000
 //!< Serial baud rate for in and out
 #define SERIAL_BAUD_RATE 9600
+//!< Animate the LEDs from the timer interrupt, keeping time under load
+#define LED_TIMED true
+//!< Matrix output the podium button routes
+#define PODIUM_OUTPUT 2
+//!< Matrix inputs the podium button cycles through, from the first
+#define PODIUM_INPUTS 2
 
-SoftwareSerial soft(SOFT_SERIAL_RECV_PIN, SOFT_SERIAL_SEND_PIN);
-SerialPass pass(Serial, soft);
+MatrixSerial soft(SOFT_SERIAL_RECV_PIN, SOFT_SERIAL_SEND_PIN);
+SerialPass pass(HOST_PORT, soft);
 
-//Two buttons, one interrupt driven, the other not
-Button b_podium(BUTTON_HDMI_PIN, HDMI_DEBOUNCE_INTERVAL_MS,
+//Two buttons, the podium interrupt driven for low latency, the other polled
+Button<BUTTON_HDMI_PIN> b_podium(HDMI_DEBOUNCE_INTERVAL_MS,
         BUTTON_PODIUM, true);
-Button b_display(BUTTON_DISPLAY_PIN, DISPLAY_DEBOUNCE_INTERVAL_MS,
+Button<BUTTON_DISPLAY_PIN> b_display(DISPLAY_DEBOUNCE_INTERVAL_MS,
         BUTTON_DISPLAY, false);
 
 //Indicators: LED13, RGB, and OLED screen
-LED13 i_led(13);
+LED13<13> i_led(LED_TIMED);
 OLED i_oled;
-RGB i_rgb(9, 10, 11);
+RGB<9, 10, 11> i_rgb(LED_TIMED);
 
-//Setup the indicator array to run
+//Setup the indicator array to run, and the bus fanning events out to them
 Indicator* indicators[] = {&i_oled, &i_rgb, &i_led};
+typedef Bus<Subscriber<OLED, i_oled>,
+            Subscriber<RGB<9, 10, 11>, i_rgb>,
+            Subscriber<LED13<13>, i_led> > IndicatorBus;
 
 //Setup non-indicator runners
-Button* buttons[] = {&b_podium, &b_display};
+ButtonBase* buttons[] = {&b_podium, &b_display};
+//Journal keeping the messages, routing, and message shown across resets
+Journal journal(pass, i_oled);
+//Boot stages, brought up from the schedule once the passthrough is live
+Boot boot(reinterpret_cast<Runner**>(indicators), NUM_ARRAY_ELEMENTS(indicators));
 /**
  * What to do when the podium button is pressed.
  */
 void podium_press(ButtonType button) {
-    pass.interrupt();
-    //Error all the indicators
-    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(indicators); i++) {
-        indicators[i]->button_pressed(button);
-    }
+    pass.cycle(PODIUM_OUTPUT, PODIUM_INPUTS);
+    PressEvent event = {button};
+    IndicatorBus::publish(event);
 }
 /**
  * What to do when the display button is pressed.
  */
 void display_press(ButtonType button) {
-    //Error all the indicators
-    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(indicators); i++) {
-        indicators[i]->button_pressed(button);
-    }
+    PressEvent event = {button};
+    IndicatorBus::publish(event);
 }
 /**
  * Define the error handling function, which passes the arguments
@@ -79,48 +88,63 @@ void display_press(ButtonType button) {
  * Note: this is declared in "types.hpp" for use system wide
  */
 void error(const char* file, const int line, const char* message) {
-    //Error all the indicators
-    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(indicators); i++) {
-        indicators[i]->error(file, line, message);
-    }
-    REPORT_ERROR("Carlos!");
+    ErrorEvent event = {file, line, message};
+    IndicatorBus::publish(event);
+}
+/**
+ * What to do when bytes were passed on to a serial port, once a batch from
+ * the passthrough's loop.
+ */
+void serial_activity(SerialType serial) {
+    SerialEvent event = {serial};
+    IndicatorBus::publish(event);
 }
 /**
  * Setup:
  *
  * Run one time function used to setup the serial device and 
- * interrupts based on the button push.
+ * interrupts based on the button push. Only what the passthrough needs is
+ * set up here, the indicators are brought up by the boot stages. The state
+ * journalled before the reset is restored first.
  */
 void setup() {
     //Setup button handle registrars
     b_podium.register_handler(&podium_press);
     b_display.register_handler(&display_press);
-    //Launch the serial port code
+    pass.register_handler(&serial_activity);
+    //Launch the serial port code, with the state from before the reset
     pass.begin(SERIAL_BAUD_RATE);
+    journal.restore();
     //Register all runners
     Runner::register_sleeper(&pass);
     Runner::register_runners(reinterpret_cast<Runner**>(buttons), NUM_ARRAY_ELEMENTS(buttons));
-    Runner::register_runners(reinterpret_cast<Runner**>(indicators), NUM_ARRAY_ELEMENTS(indicators));
-    //Allow serial port to start-up, and system to become quiescent
-    //before starting up standard rate group drivers
-    delay(STARUP_TIME_MS);
+    Runner* scheduled[] = {&journal, &boot};
+    Runner::register_runners(scheduled, NUM_ARRAY_ELEMENTS(scheduled));
+    Runner::start();
+    Boot::live();
 }
 /**
- * Loop calling runners once every N milliseconds
+ * Loop dispatching button presses, and runners as their releases come due
  */
 void loop() {
+    ButtonBase::dispatch();
     Runner::cycle();
 }
 
 /**
  * Main function:
  *
- * Some potential boards do not use the arduino compiler so this
- * mimics what the arduino compiler does.
+ * The native build does not use the arduino compiler so this
+ * mimics what the arduino compiler does, against the simulator. Unit tests
+ * bring their own.
  */
-/*int main(int argc, char** argv) {
+#if !defined(ARDUINO) && !defined(PIO_UNIT_TESTING)
+int main(int argc, char** argv) {
+    Sim::begin(argc, argv);
     setup();
-    while(1) {
+    while(Sim::running()) {
         loop();
     }
-}*/
+    return Sim::end();
+}
+#endif
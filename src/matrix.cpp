@@ -0,0 +1,51 @@
+/*
+ * matrix.cpp:
+ *
+ * Matrix routing state implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include "matrix.hpp"
+
+MatrixState::MatrixState() {
+    invalidate();
+}
+void MatrixState::route(uint8_t output, uint8_t input) {
+    if (output >= 1 && output <= MATRIX_OUTPUTS) {
+        m_routes[output - 1] = input;
+    }
+}
+uint8_t MatrixState::input(uint8_t output) const {
+    if (output < 1 || output > MATRIX_OUTPUTS) {
+        return MATRIX_UNKNOWN;
+    }
+    return m_routes[output - 1];
+}
+bool MatrixState::complete() const {
+    for (unsigned int i = 0; i < MATRIX_OUTPUTS; i++) {
+        if (m_routes[i] == MATRIX_UNKNOWN) {
+            return false;
+        }
+    }
+    return true;
+}
+void MatrixState::invalidate() {
+    for (unsigned int i = 0; i < MATRIX_OUTPUTS; i++) {
+        m_routes[i] = MATRIX_UNKNOWN;
+    }
+}
+/**
+ * Two digit fields, as the matrix sends them
+ */
+void MatrixState::reply(Print& out) const {
+    out.print(F(MATRIX_FRAME_START MATRIX_ROUTES_CODE));
+    for (uint8_t i = 0; i < MATRIX_OUTPUTS; i++) {
+        uint8_t fields[2] = {static_cast<uint8_t>(i + 1), m_routes[i]};
+        for (unsigned int j = 0; j < NUM_ARRAY_ELEMENTS(fields); j++) {
+            out.write(static_cast<uint8_t>('0' + (fields[j] / 10) % 10));
+            out.write(static_cast<uint8_t>('0' + fields[j] % 10));
+        }
+    }
+    out.print(F(MATRIX_FRAME_END));
+}
@@ -0,0 +1,70 @@
+/*
+ * matrix.hpp:
+ *
+ * Model of the matrix switch's routing state: the input routed to each output.
+ * SerialPass keeps it up to date from the SW commands it sends, and from the
+ * read replies it passes back, such that it can answer reads itself.
+ *
+ * Matrix frames are "MT00", a two character command code, parameters, then
+ * "NT". Switch commands carry a two digit input then a two digit output. Read
+ * replies carry a two digit output then its two digit input, for each output.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_MATRIX_HPP_
+#define SRC_MATRIX_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Inputs on the matrix
+#define MATRIX_INPUTS 10
+//!< Outputs on the matrix, and pairs in a read reply
+#define MATRIX_OUTPUTS 10
+//!< Frame start, before the command code
+#define MATRIX_FRAME_START "MT00"
+//!< Frame end
+#define MATRIX_FRAME_END "NT"
+//!< Size of a read reply: start, code, a pair per output, and end
+#define MATRIX_REPLY_SIZE (8 + 4 * MATRIX_OUTPUTS)
+//!< Routed input of an output not yet known
+#define MATRIX_UNKNOWN 0
+//!< Command code reading all routes, and its frame
+#define MATRIX_ROUTES_CODE "RD"
+#define MATRIX_READ_FRAME MATRIX_FRAME_START MATRIX_ROUTES_CODE "0000" MATRIX_FRAME_END
+
+class MatrixState {
+    public:
+        /**
+         * Construct the model with every route unknown.
+         */
+        MatrixState();
+        /**
+         * Record a route. Out of range outputs are ignored.
+         * \param uint8_t output: output, from 1
+         * \param uint8_t input: input routed to it, from 1
+         */
+        void route(uint8_t output, uint8_t input);
+        /**
+         * Input routed to an output.
+         * \param uint8_t output: output, from 1
+         * \return input, or MATRIX_UNKNOWN
+         */
+        uint8_t input(uint8_t output) const;
+        /**
+         * Are all routes known.
+         */
+        bool complete() const;
+        /**
+         * Forget all routes.
+         */
+        void invalidate();
+        /**
+         * Print a read reply of the modelled routes.
+         * \param Print& out: output to print to
+         */
+        void reply(Print& out) const;
+    private:
+        //!< Input routed to each output
+        uint8_t m_routes[MATRIX_OUTPUTS];
+};
+#endif /* SRC_MATRIX_HPP_ */
@@ -8,28 +8,45 @@
  */
 #include <string.h>
 #include "oled.hpp"
+//!< Unchanged page marker, as the first changed column
+#define OLED_CLEAN 0xFF
+
+/**
+ * Copy at most count characters of a string, terminating the copy.
+ */
+static void copy(char* text, const char* source, uint8_t count) {
+    uint8_t length = strnlen(source, count);
+    memcpy(text, source, length);
+    text[length] = '\0';
+}
 /**
  * Constructor sets up the default values in m_ip and m_name
  */
-OLED::OLED() : Indicator(),
-    m_display(SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT),
+OLED::OLED() : Indicator(OLED_PERIOD_MS, OLED_PHASE_MS),
+    m_display(OLED_ADDRESS, OLED_I2C_CLOCK),
     m_index(0),
-    m_update_count(0),
     m_updated(true),
-    m_first_error(true)
-{}
+    m_first_error(true),
+    m_page(OLED_PAGES),
+    m_shown(OLED_BLANK),
+    m_window(0),
+    m_scrolling(false),
+    m_scroll_time(0)
+{
+    memset(m_first, OLED_CLEAN, sizeof(m_first));
+    memset(m_last, 0, sizeof(m_last));
+    m_shown_key[0] = '\0';
+    m_shown_msg[0] = '\0';
+}
 /**
- * Sets up the OLED screen by calling being for the OLED driver.
+ * Sets up the OLED screen by calling begin for the OLED driver, and marks
+ * every page to be cleared by run, as the blank screen shown. Nothing waits
+ * on the bus.
  */
 bool OLED::setup() {
-    bool disp;
-    if ((disp = m_display.begin(SSD1306_SWITCHCAPVCC, 0x3C))) {
-        //Splash screen. OH YEAH!
-        m_display.clearDisplay();
-        m_display.display();
-        //Global setups for later
-        m_display.setTextSize(2);
-        m_display.setTextColor(WHITE);
+    m_display.begin();
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        redraw(page);
     }
     return true;
 }
@@ -38,41 +55,219 @@ bool OLED::setup() {
  */
 void OLED::button_pressed(ButtonType button) {
     if (button == BUTTON_DISPLAY) {
-        m_index = (m_index + 1) % MAX_MSG_COUNT;
+        m_index = (m_index + 1) % s_store.count();
     }
     m_updated = true;
 }
+uint8_t OLED::shown() const {
+    return m_index;
+}
+void OLED::show(uint8_t index) {
+    m_index = index;
+    m_updated = true;
+}
+/**
+ * Messages are the key at size 2, then the message below, a row's window of
+ * it at a time. Errors are the message at size 2 over two rows, then the
+ * file and line.
+ */
+uint8_t OLED::row(OledScreen screen, const char* key, const char* msg, uint8_t window,
+                  uint8_t page, char* text) {
+    text[0] = '\0';
+    if (screen == OLED_MESSAGE) {
+        if (page == 0) {
+            copy(text, key, MAX_KEY_LEN);
+            strcat(text, ":");
+            return 2;
+        } else if (page == OLED_MESSAGE_PAGE) {
+            uint8_t length = strnlen(msg, MAX_STR_LEN);
+            window = (window < length) ? window : length;
+            copy(text, msg + window, OLED_COLUMNS);
+            return 1;
+        }
+    } else if (screen == OLED_ERROR) {
+        uint8_t length = strnlen(s_error_message, MAX_STR_LEN);
+        if (page == 0) {
+            copy(text, s_error_message, OLED_WIDE_COLUMNS);
+            return 2;
+        } else if (page == 2) {
+            if (length > OLED_WIDE_COLUMNS) {
+                copy(text, s_error_message + OLED_WIDE_COLUMNS, OLED_WIDE_COLUMNS);
+            }
+            return 2;
+        } else if (page == 4) {
+            copy(text, s_error_file, OLED_COLUMNS);
+            return 1;
+        } else if (page == 5) {
+            //Line number digits, least significant first, then reversed
+            unsigned int line = (s_error_line < 0) ? 0 : s_error_line;
+            uint8_t count = 0;
+            do {
+                text[count++] = '0' + (line % 10);
+                line /= 10;
+            } while (line > 0);
+            for (uint8_t i = 0; i < count / 2; i++) {
+                char swap = text[i];
+                text[i] = text[count - 1 - i];
+                text[count - 1 - i] = swap;
+            }
+            text[count] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+/**
+ * Rows starting on the same page at the same size differ only in the
+ * characters that differ, blank past the end of the shorter. Otherwise both
+ * rows are changed in full.
+ */
+void OLED::diff(OledScreen screen, const char* key, const char* msg) {
+    char before[OLED_COLUMNS + 1];
+    char after[OLED_COLUMNS + 1];
+    for (uint8_t page = 0; page < OLED_PAGES; page++) {
+        uint8_t old_size = row(m_shown, m_shown_key, m_shown_msg, m_window, page, before);
+        uint8_t new_size = row(screen, key, msg, 0, page, after);
+        uint8_t old_length = strlen(before);
+        uint8_t new_length = strlen(after);
+        if (old_size != new_size) {
+            if (old_length > 0) {
+                mark(page, old_size, 0, old_length - 1);
+            }
+            if (new_length > 0) {
+                mark(page, new_size, 0, new_length - 1);
+            }
+            continue;
+        }
+        uint8_t length = (old_length > new_length) ? old_length : new_length;
+        uint8_t first = OLED_CLEAN;
+        uint8_t last = 0;
+        for (uint8_t i = 0; i < length; i++) {
+            char was = (i < old_length) ? before[i] : ' ';
+            char now = (i < new_length) ? after[i] : ' ';
+            if (was != now) {
+                first = (first == OLED_CLEAN) ? i : first;
+                last = i;
+            }
+        }
+        if (first != OLED_CLEAN) {
+            mark(page, new_size, first, last);
+        }
+    }
+}
+
+void OLED::mark(uint8_t page, uint8_t size, uint8_t first, uint8_t last) {
+    uint8_t width = DISPLAY_CHAR_WIDTH * size;
+    uint16_t end = (static_cast<uint16_t>(last) + 1) * width - 1;
+    uint8_t start = first * width;
+    end = (end < DISPLAY_WIDTH) ? end : (DISPLAY_WIDTH - 1);
+    for (uint8_t i = page; i < (page + size) && i < OLED_PAGES; i++) {
+        m_first[i] = (start < m_first[i]) ? start : m_first[i];
+        m_last[i] = (end > m_last[i]) ? end : m_last[i];
+    }
+}
+/**
+ * Scrolled pages are shifted in the panel's RAM, so the whole page is
+ * drawn again
+ */
+void OLED::redraw(uint8_t page) {
+    m_first[page] = 0;
+    m_last[page] = DISPLAY_WIDTH - 1;
+    m_page = 0;
+}
+/**
+ * A message too long for its row scrolls as a ticker
+ */
+bool OLED::ticker() const {
+    return m_shown == OLED_MESSAGE && strnlen(m_shown_msg, MAX_STR_LEN) > OLED_COLUMNS;
+}
 /**
  * Implementation of the run function. Remember: all work must be done in
- * snapshots that occur 1/Nms. This means *no* long-running work.
+ * snapshots that occur every OLED_PERIOD_MS. This means *no* long-running work.
+ * A redraw only marks what changed. The following runs each draw the changed
+ * columns of one page, skipping unchanged pages, and no redraw starts until
+ * all are drawn. Drawing only queues the page, which is sent in the
+ * background.
+ *
+ * A ticker scrolls on the panel once all is drawn. Each time the panel has
+ * turned its row round, the next window of the message is streamed in: the
+ * scroll is stopped, the row drawn, and the scroll started again. Drawing
+ * anything else stops the scroll the same way.
  */
 void OLED::run() {
-    m_updated = m_updated || m_update_count == 0;
-    m_update_count = (m_update_count + 1) % 20;
+    m_updated = m_updated || Runner::interval_check(OLED_REFRESH_MS);
+    //The last page drawn is still being sent in the background
+    if (!m_display.idle()) {
+        return;
+    }
+    //Step the ticker on to the next window of the message, wrapping
+    uint16_t now = static_cast<uint16_t>(millis());
+    if (m_scrolling && static_cast<uint16_t>(now - m_scroll_time) >= OLED_TICKER_MS) {
+        m_window += OLED_COLUMNS;
+        m_window = (m_window < strnlen(m_shown_msg, MAX_STR_LEN)) ? m_window : 0;
+        redraw(OLED_MESSAGE_PAGE);
+    }
+    //Draw the changed columns of the next changed page, from the row on it:
+    //one starting on it, the lower band of a size 2 row above, or none
+    while (m_page < OLED_PAGES && m_first[m_page] == OLED_CLEAN) {
+        m_page++;
+    }
+    if (m_page < OLED_PAGES && m_scrolling) {
+        m_display.stop();
+        m_scrolling = false;
+        redraw(OLED_MESSAGE_PAGE);
+        return;
+    }
+    if (m_page < OLED_PAGES) {
+        char text[OLED_COLUMNS + 1];
+        uint8_t band = 0;
+        uint8_t size = row(m_shown, m_shown_key, m_shown_msg, m_window, m_page, text);
+        if (size == 0 && m_page > 0 &&
+            row(m_shown, m_shown_key, m_shown_msg, m_window, m_page - 1, text) == 2) {
+            size = 2;
+            band = 1;
+        }
+        size = (size == 0) ? 1 : size;
+        m_display.draw(m_page, m_first[m_page], m_last[m_page], text, size, band);
+        m_first[m_page] = OLED_CLEAN;
+        m_last[m_page] = 0;
+        m_page++;
+        return;
+    }
+    //All drawn, start the ticker
+    if (!m_scrolling && ticker()) {
+        m_display.scroll(OLED_MESSAGE_PAGE, OLED_MESSAGE_PAGE);
+        m_scrolling = true;
+        m_scroll_time = now;
+        return;
+    }
     //No updates, don't waste time
     if (!m_updated && !(m_first_error && s_error_state)) {
         return;
     }
-    //Prepare display for future work
-    m_display.clearDisplay();
-    m_display.setCursor(0,0);
+    m_updated = false;
+    OledScreen screen = OLED_MESSAGE;
+    char key[MAX_KEY_LEN + 1];
+    char msg[MAX_STR_LEN + 1];
+    //Making room for a long message may have pushed out other keys
+    m_index = (m_index < s_store.count()) ? m_index : (s_store.count() - 1);
+    s_store.get(m_index, key, msg);
     //Handle errors
     if (s_error_state) {
         m_first_error = false;
-        m_display.println(s_error_message);
-        //m_display.setCursor(0,16);
-        m_display.print(s_error_file);
-        m_display.print(":");
-        m_display.print(s_error_line);
+        screen = OLED_ERROR;
     }
-    else {
-        m_updated = false;
-        m_display.print(Indicator::s_key_store[m_index]);
-        m_display.println(":");
-        m_display.setTextSize(1);
-        m_display.println(Indicator::s_msg_store[m_index]);
-        m_display.setTextSize(2);
+    //Same text as shown, nothing to draw or send
+    if (screen == m_shown && (screen == OLED_ERROR ||
+        (strncmp(key, m_shown_key, MAX_KEY_LEN) == 0 &&
+         strncmp(msg, m_shown_msg, MAX_STR_LEN) == 0))) {
+        return;
     }
-    //Display the data in the display buffer
-    m_display.display();
+    diff(screen, key, msg);
+    m_shown = screen;
+    m_window = 0;
+    copy(m_shown_key, key, MAX_KEY_LEN);
+    copy(m_shown_msg, msg, MAX_STR_LEN);
+    //Draw the changed columns from the next run on
+    m_page = 0;
 }
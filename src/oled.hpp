@@ -8,20 +8,60 @@
  * 1. IP Address: will set the IP address of the machine, once known.
  * 2. Room name: will set the IP address of the box, once known.
  *
+ * The screen is laid out in text rows, each starting on a page (an 8 pixel
+ * high band) at text size 1 or 2. The OLED remembers the text it last drew,
+ * and before drawing compares the new text to it, row by row, to find the
+ * columns of each page that change. Only those are drawn to the panel, and
+ * nothing at all when the text is the same. There is no framebuffer: the text
+ * is the only copy of the screen, and is drawn straight to the panel.
+ *
+ * Messages too long for their row are shown as a ticker: the panel scrolls
+ * the row itself, and each turn round the next row's worth of the message is
+ * streamed in, so the ticker costs nothing per frame.
+ *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
 #ifndef SRC_OLED_HPP_
 #define SRC_OLED_HPP_
-//Wire and SPI libraries
-#include <Arduino.h>
-#include <SPI.h>
-#include <Wire.h>
-//Includes for Adafruit library
-#include <Adafruit_GFX.h>
-#include <Adafruit_SSD1306.h>
+#include "hal.hpp"
 #include "types.hpp"
 #include "indicator.hpp"
+#include "display.hpp"
+//!< Run period of the OLED. A redraw takes one run, then each page one run,
+//!< sent in the background before the next.
+#define OLED_PERIOD_MS 20
+//!< Run phase of the OLED, keeps it off the button releases
+#define OLED_PHASE_MS 13
+//!< Interval between checks of the shown message for changes
+#define OLED_REFRESH_MS 2000
+//!< Pages on the panel, each an 8 pixel high band drawn in one run
+#define OLED_PAGES DISPLAY_PAGES
+//!< Characters in a size 1 row
+#define OLED_COLUMNS (DISPLAY_WIDTH / DISPLAY_CHAR_WIDTH)
+//!< Characters in a size 2 row
+#define OLED_WIDE_COLUMNS (OLED_COLUMNS / 2)
+//!< Page of the message row, scrolled as a ticker when too long for it
+#define OLED_MESSAGE_PAGE 2
+//!< Time a ticker window shows, as the panel turns its row round once
+#define OLED_TICKER_MS DISPLAY_SCROLL_TURN_MS
+//!< I2C clock: 400kHz fast mode, a page taking ~3.3ms on the bus. Set 100000
+//!< for standard mode, ~13ms a page, on long or weakly pulled up wiring.
+#define OLED_I2C_CLOCK 400000UL
+//!< I2C address of the panel
+#define OLED_ADDRESS 0x3C
+
+/**
+ * OledScreen:
+ *
+ * What a screen shows.
+ */
+enum OledScreen {
+    OLED_BLANK,   //!< Nothing, as the panel starts
+    OLED_MESSAGE, //!< A stored key and message
+    OLED_ERROR,   //!< The error message and its location
+};
+
 class OLED : public Indicator
 {
     public:
@@ -37,20 +77,78 @@ class OLED : public Indicator
 	 * A button has been pressed.  We only care about the front button.
 	 */
         void button_pressed(ButtonType button);
+        /**
+         * Index of the message shown, as chosen with the display button.
+         */
+        uint8_t shown() const;
+        /**
+         * Choose the message shown, as after a reset.
+         * \param uint8_t index: message, clamped to those stored when shown
+         */
+        void show(uint8_t index);
         /**
          * Overrides run to provide OLED specific actions
          */
         void run();
     protected:
+        /**
+         * Lay out the text row starting on a page of a screen.
+         * \param OledScreen screen: what the screen shows
+         * \param const char* key: key shown by an OLED_MESSAGE screen
+         * \param const char* msg: message shown by an OLED_MESSAGE screen
+         * \param uint8_t window: first character of the message shown
+         * \param uint8_t page: page the row starts on
+         * \param char* text: filled with the row's text, OLED_COLUMNS + 1 long
+         * \return text size of the row, 0 if no row starts on the page
+         */
+        static uint8_t row(OledScreen screen, const char* key, const char* msg,
+                           uint8_t window, uint8_t page, char* text);
+        /**
+         * Mark the columns of the pages that differ between the shown screen
+         * and a new one.
+         * \param OledScreen screen: what the new screen shows
+         * \param const char* key: key of the new screen
+         * \param const char* msg: message of the new screen
+         */
+        void diff(OledScreen screen, const char* key, const char* msg);
+        /**
+         * Mark columns of pages as changed.
+         * \param uint8_t page: first page
+         * \param uint8_t size: text size, pages to mark
+         * \param uint8_t first: first character changed
+         * \param uint8_t last: last character changed
+         */
+        void mark(uint8_t page, uint8_t size, uint8_t first, uint8_t last);
+        /**
+         * Mark a whole page as changed, and look for changes from the top.
+         * \param uint8_t page: page
+         */
+        void redraw(uint8_t page);
+        /**
+         * Is the shown message too long for its row.
+         */
+        bool ticker() const;
         //!< OLED screen to display to
-        Adafruit_SSD1306 m_display;
+        TextDisplay m_display;
         //!< Index of current display
         uint8_t m_index;
-        //!< Current count 
-        uint8_t m_update_count;
         //!< Updated message
         bool m_updated;
         //!< First error
         bool m_first_error;
+        //!< Next page to check for changes to draw, OLED_PAGES once all drawn
+        uint8_t m_page;
+        //!< First and last changed column of each page, first > last if none
+        uint8_t m_first[OLED_PAGES];
+        uint8_t m_last[OLED_PAGES];
+        //!< What the panel shows, and the key and message it shows
+        OledScreen m_shown;
+        char m_shown_key[MAX_KEY_LEN + 1];
+        char m_shown_msg[MAX_STR_LEN + 1];
+        //!< First character of the shown message in its row
+        uint8_t m_window;
+        //!< The panel is scrolling the message row, since when
+        bool m_scrolling;
+        uint16_t m_scroll_time;
 };
 #endif /* SRC_OLED_HPP_ */
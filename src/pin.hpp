@@ -0,0 +1,193 @@
+/*
+ * pin.hpp:
+ *
+ * Compile-time pins. Pin<PIN> resolves the port and bit of a Nano pin, and
+ * the compare register of its PWM timer, at compile time. Each access thus
+ * compiles down to a single register instruction (sbi, cbi, sbis, or a store
+ * to the compare register), in place of digitalRead, digitalWrite, and
+ * analogWrite with their pin table lookups and timer checks.
+ *
+ * Nano pins D0-D7 are port D, D8-D13 port B, and A0-A5 (14-19) port C. PWM is
+ * on pins 3 and 11 (Timer2), 5 and 6 (Timer0), and 9 and 10 (Timer1). While
+ * the SoftUart holds Timer1, duty on pins 9 and 10 is scaled to its TOP. A
+ * duty of 0 disconnects the timer and drives the pin low, as fast PWM still
+ * pulses the pin once a period at a compare of 0.
+ *
+ * On the native build, the same calls go to the simulator's pins.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_PIN_HPP_
+#define SRC_PIN_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Pins on a Nano: D0-D13 and A0-A5
+#define PIN_COUNT 20
+
+template <uint8_t PIN>
+class Pin {
+    static_assert(PIN < PIN_COUNT, "Not a Nano pin");
+    public:
+        /**
+         * Make the pin an output.
+         */
+        static void output();
+        /**
+         * Make the pin an input, pulled up.
+         */
+        static void input_pullup();
+        /**
+         * Drive an output pin.
+         * \param bool high: drive high, else low
+         */
+        static void write(bool high);
+        /**
+         * Read the pin's level.
+         * \return true if high
+         */
+        static bool read();
+        /**
+         * Connect the pin's timer output, such that pwm drives it. The pin
+         * must be an output.
+         */
+        static void pwm_enable();
+        /**
+         * Set the PWM duty of the pin. A duty of 0 disconnects the timer
+         * output and drives the pin low, and any other connects it again.
+         * \param uint8_t duty: duty cycle, 0-255
+         */
+        static void pwm(uint8_t duty);
+#ifdef ARDUINO
+    private:
+        /**
+         * Connect or disconnect the pin's timer output.
+         * \param bool on: connect, else disconnect
+         */
+        static void connect(bool on);
+        //!< Bit of the pin in its port
+        static const uint8_t BIT = _BV((PIN < 8) ? PIN : ((PIN < 14) ? (PIN - 8) : (PIN - 14)));
+#endif
+};
+
+#ifdef ARDUINO
+//Port selection is on a constant, so only one branch is ever compiled in
+template <uint8_t PIN>
+inline void Pin<PIN>::output() {
+    if (PIN < 8) {
+        DDRD |= BIT;
+    } else if (PIN < 14) {
+        DDRB |= BIT;
+    } else {
+        DDRC |= BIT;
+    }
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::input_pullup() {
+    if (PIN < 8) {
+        DDRD &= ~BIT;
+        PORTD |= BIT;
+    } else if (PIN < 14) {
+        DDRB &= ~BIT;
+        PORTB |= BIT;
+    } else {
+        DDRC &= ~BIT;
+        PORTC |= BIT;
+    }
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::write(bool high) {
+    if (PIN < 8) {
+        if (high) { PORTD |= BIT; } else { PORTD &= ~BIT; }
+    } else if (PIN < 14) {
+        if (high) { PORTB |= BIT; } else { PORTB &= ~BIT; }
+    } else {
+        if (high) { PORTC |= BIT; } else { PORTC &= ~BIT; }
+    }
+}
+template <uint8_t PIN>
+inline bool Pin<PIN>::read() {
+    if (PIN < 8) {
+        return (PIND & BIT) != 0;
+    } else if (PIN < 14) {
+        return (PINB & BIT) != 0;
+    }
+    return (PINC & BIT) != 0;
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::connect(bool on) {
+    static_assert(PIN == 3 || PIN == 5 || PIN == 6 || PIN == 9 || PIN == 10 || PIN == 11,
+                  "Not a PWM pin");
+    uint8_t sreg = SREG;
+    cli();
+    switch (PIN) {
+        case 3: TCCR2A = on ? (TCCR2A | _BV(COM2B1)) : (TCCR2A & ~_BV(COM2B1)); break;
+        case 5: TCCR0A = on ? (TCCR0A | _BV(COM0B1)) : (TCCR0A & ~_BV(COM0B1)); break;
+        case 6: TCCR0A = on ? (TCCR0A | _BV(COM0A1)) : (TCCR0A & ~_BV(COM0A1)); break;
+        case 9: TCCR1A = on ? (TCCR1A | _BV(COM1A1)) : (TCCR1A & ~_BV(COM1A1)); break;
+        case 10: TCCR1A = on ? (TCCR1A | _BV(COM1B1)) : (TCCR1A & ~_BV(COM1B1)); break;
+        default: TCCR2A = on ? (TCCR2A | _BV(COM2A1)) : (TCCR2A & ~_BV(COM2A1)); break;
+    }
+    SREG = sreg;
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::pwm_enable() {
+    connect(true);
+}
+/**
+ * Timer1 runs to ICR1 while the SoftUart holds it, and to 0xFF otherwise. The
+ * compare is set before the output is connected, so it starts at the duty.
+ */
+template <uint8_t PIN>
+inline void Pin<PIN>::pwm(uint8_t duty) {
+    static_assert(PIN == 3 || PIN == 5 || PIN == 6 || PIN == 9 || PIN == 10 || PIN == 11,
+                  "Not a PWM pin");
+    if (duty == 0) {
+        connect(false);
+        write(false);
+        return;
+    }
+    if (PIN == 9 || PIN == 10) {
+        uint16_t value = (TIMSK1 & _BV(TOIE1)) ?
+            ((static_cast<uint16_t>(duty) * (ICR1 + 1)) >> 8) : duty;
+        if (PIN == 9) {
+            OCR1A = value;
+        } else {
+            OCR1B = value;
+        }
+    } else {
+        switch (PIN) {
+            case 3: OCR2B = duty; break;
+            case 5: OCR0B = duty; break;
+            case 6: OCR0A = duty; break;
+            default: OCR2A = duty; break;
+        }
+    }
+    connect(true);
+}
+#else
+//The simulator's pins stand in for the port registers
+template <uint8_t PIN>
+inline void Pin<PIN>::output() {
+    pinMode(PIN, OUTPUT);
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::input_pullup() {
+    pinMode(PIN, INPUT_PULLUP);
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::write(bool high) {
+    digitalWrite(PIN, high ? HIGH : LOW);
+}
+template <uint8_t PIN>
+inline bool Pin<PIN>::read() {
+    return digitalRead(PIN) == HIGH;
+}
+template <uint8_t PIN>
+inline void Pin<PIN>::pwm_enable() {}
+template <uint8_t PIN>
+inline void Pin<PIN>::pwm(uint8_t duty) {
+    analogWrite(PIN, duty);
+}
+#endif
+#endif /* SRC_PIN_HPP_ */
@@ -7,123 +7,104 @@
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
-#include <Arduino.h>
-#include <string.h>
+#include "hal.hpp"
 #include "rgb.hpp"
 
-//!< Maximum macro
-#define MAX(a,b) ((a >= b)?a:b)
-//!< Minimum macro
-#define MIN(a,b) ((a <= b)?a:b)
-
 //!< Note: store this memory in program (FLASH) not in stack. Save memory.
-//!< Array of arrays of color values. 0xFF is full-on, 0 is off.
-const unsigned int RGB::POINTS[] PROGMEM = {
-        0xFF, 0x00, 0x00, //!< RED
-        0xFF, 0xFF, 0x00, //!< YELLOW
-        0x00, 0xFF, 0x00, //!< GREEN
-        0x00, 0xFF, 0xFF, //!< BLUE-GREEN
-        0x00, 0x00, 0xFF, //!< BLUE
-        0xFF, 0x00, 0xFF, //!< PURPLE
+//!< Rainbow waypoints, fading from one to the next. 0xFF is full-on, 0 is off.
+static const Keyframe RAINBOW_FRAMES[] PROGMEM = {
+        keyframe(0xFF, 0x00, 0x00, RGB_WAYPOINT_MS), //!< RED
+        keyframe(0xFF, 0xFF, 0x00, RGB_WAYPOINT_MS), //!< YELLOW
+        keyframe(0x00, 0xFF, 0x00, RGB_WAYPOINT_MS), //!< GREEN
+        keyframe(0x00, 0xFF, 0xFF, RGB_WAYPOINT_MS), //!< BLUE-GREEN
+        keyframe(0x00, 0x00, 0xFF, RGB_WAYPOINT_MS), //!< BLUE
+        keyframe(0xFF, 0x00, 0xFF, RGB_WAYPOINT_MS), //!< PURPLE
+};
+//!< Full blue at once, dropping low and fading back up
+static const Keyframe PRESS_FRAMES[] PROGMEM = {
+        keyframe(0x00, 0x00, 0xFF, 1),
+        keyframe(0x00, 0x00, 0x10, RGB_PRESS_MS),
+        keyframe(0x00, 0x00, 0xFF, 0),
 };
 //!< Color to display on error
-const unsigned int RGB::ERROR_POINTS[] PROGMEM = {
-        0xFF, 0x00, 0x00,
-        0x00, 0x00, 0x00
+static const Keyframe ERROR_FRAMES[] PROGMEM = {
+        keyframe(0xFF, 0x00, 0x00, RGB_WAYPOINT_MS),
+        keyframe(0x00, 0x00, 0x00, RGB_WAYPOINT_MS),
+};
+static const Keyframe OFF_FRAMES[] PROGMEM = {
+        keyframe(0x00, 0x00, 0x00, 0),
 };
+const Pattern RGBBase::PATTERN_RAINBOW = {RAINBOW_FRAMES, NUM_ARRAY_ELEMENTS(RAINBOW_FRAMES), true};
+const Pattern RGBBase::PATTERN_PRESS = {PRESS_FRAMES, NUM_ARRAY_ELEMENTS(PRESS_FRAMES), false};
+const Pattern RGBBase::PATTERN_ERROR = {ERROR_FRAMES, NUM_ARRAY_ELEMENTS(ERROR_FRAMES), true};
+const Pattern RGBBase::PATTERN_OFF = {OFF_FRAMES, NUM_ARRAY_ELEMENTS(OFF_FRAMES), false};
+//Initialize static pointer
+RGBBase* RGBBase::s_timed = NULL;
 /**
- * Attach to given pins, and set their types.
+ * Start dark. The pins are set up by RGB.
  */
-RGB::RGB(int rpin, int gpin, int bpin) :
-    m_countdown(0),
-    m_index(0)
+RGBBase::RGBBase(bool timed) :
+    Indicator(timed ? RGB_TIMED_PERIOD_MS : RGB_PERIOD_MS, RGB_PHASE_MS),
+    m_timed(timed),
+    m_frame_ms(0)
 {
-    m_pin[RED] = rpin;
-    m_pin[GREEN] = gpin;
-    m_pin[BLUE] = bpin;
-    //Setup output pins for all colors
-    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(m_pin); i++) {
-        pinMode(m_pin[i], OUTPUT);
+    m_animation.play(&PATTERN_OFF);
+}
+/**
+ * Without room on the Ticker, frames are stepped from run instead, at the
+ * slower run rate
+ */
+bool RGBBase::setup() {
+    if (m_timed) {
+        s_timed = this;
+        m_timed = Ticker::attach(RGBBase::tick);
     }
-    //Initialize color to be the first three words
-    m_color[0] = pgm_read_word_near(POINTS + 0);
-    m_color[1] = pgm_read_word_near(POINTS + 1);
-    m_color[2] = pgm_read_word_near(POINTS + 2);
+    return true;
 }
 /**
- * Run function slowly walks through way-points. Each waypoint represents an equi-
- * distant point to walk through.
+ * A press plays through before the state's pattern takes over again. Patterns
+ * only restart when they change. The pattern is swapped with interrupts off,
+ * out from under the timer interrupt.
  */
-void RGB::run() {
-    //ASSERT(COLOR_COUNT == NUM_ARRAY_ELEMENTS(m_pin), "Color count failure");
-    unsigned int next_index = 0;
-    unsigned int current[COLOR_COUNT]; //Current waypoint
-    unsigned int next[COLOR_COUNT]; //Next waypoint
-    const unsigned int *waypoints;
+void RGBBase::run() {
+    noInterrupts();
     // A podium button was pressed
     if (m_pressed[BUTTON_PODIUM]) {
         m_pressed[BUTTON_PODIUM] = false;
-        m_countdown = 30;
-        analogWrite(m_pin[BLUE], 0xFF);
-        analogWrite(m_pin[RED], 0);
-        analogWrite(m_pin[GREEN], 0);
-        return;
-    }
-    // Presse expiration interval
-    else if (m_countdown > 0) {
-        m_countdown--;
-        analogWrite(m_pin[BLUE], 0xFF - (m_countdown << 3));
-        return;
-    }
-    //Assign the waypoint pointer, and next index based on the error state
-    else if (s_error_state) {
-        next_index = (m_index + COLOR_COUNT) % NUM_ARRAY_ELEMENTS(ERROR_POINTS);
-        waypoints = ERROR_POINTS;
-    }
-    else if (Indicator::s_key_store[0][0] == '\0') {
-        analogWrite(m_pin[RED], 0);
-        analogWrite(m_pin[GREEN], 0);
-        analogWrite(m_pin[BLUE], 0);
-        return;
-    } else {
-        next_index = (m_index + COLOR_COUNT) % NUM_ARRAY_ELEMENTS(POINTS);
-        waypoints = POINTS;
+        m_animation.play(&PATTERN_PRESS);
     }
-    //Assign current and next pointers
-    for (unsigned int i = 0; i < COLOR_COUNT; i++) {
-        current[i] = pgm_read_word_near(waypoints + m_index + i);
-        next[i] = pgm_read_word_near(waypoints + next_index + i);
-    }
-    //Update each color by doing the following:
-    // 1. Calculate the distance between this and next point as scalar
-    // 2. Multiply by current step size
-    // 3. Add value to color (at least +1 or -1)
-    for (unsigned int i = 0; i < COLOR_COUNT; i++) {
-        int dist = next[i] - current[i];
-        float add = ((float)(dist))/255.0f * PWM_STEP;
-        //Less than distance bottom out at next waypoint
-        if (add < -0.001) {
-            add = MIN(add, -1.1f); //Step at least 1
-            m_color[i] = MAX(m_color[i] + (int)add, next[i]);
+    else if (m_animation.playing() != &PATTERN_PRESS || m_animation.done()) {
+        const Pattern* pattern = &PATTERN_RAINBOW;
+        if (s_error_state) {
+            pattern = &PATTERN_ERROR;
+        } else if (s_store.stored() == 0) {
+            pattern = &PATTERN_OFF;
         }
-        //Otherwise max out at next waypoint
-        else if (add > 0.001) {
-            add = MAX(add, 1.1f); //Step at least 1
-            m_color[i] = MIN(m_color[i] + (int)add, next[i]);
+        if (m_animation.playing() != pattern) {
+            m_animation.play(pattern);
         }
     }
+    interrupts();
+    if (!m_timed) {
+        frame(m_period);
+    }
+}
+void RGBBase::frame(uint16_t ms) {
+    m_animation.advance(ms);
     //Loop over colors and set their output
     //Also note: shift output to keep from overloading LEDs
-    for (unsigned int i = 0; i < NUM_ARRAY_ELEMENTS(m_pin); i++) {
-        //Cap color to prevent out-of-bounds color
-        m_color[i] = MIN(m_color[i], 0xFF);
-        m_color[i] = MAX(m_color[i], 0x00);
-        analogWrite(m_pin[i], m_color[i] >> PWM_SHIFT);
+    for (unsigned int i = 0; i < COLOR_COUNT; i++) {
+        write(i, m_animation.level(i) >> PWM_SHIFT);
     }
-    //Now update the pointer
-    if (Runner::interval_check(1000)) {
-        //Jump to the next waypoint
-        memcpy(m_color, next, sizeof(m_color));
-        m_index = next_index;
+}
+/**
+ * Frames every RGB_PERIOD_MS, give or take a tick
+ */
+void RGBBase::tick(uint8_t ms) {
+    RGBBase* rgb = s_timed;
+    rgb->m_frame_ms += ms;
+    if (rgb->m_frame_ms >= RGB_PERIOD_MS) {
+        rgb->frame(rgb->m_frame_ms);
+        rgb->m_frame_ms = 0;
     }
 }
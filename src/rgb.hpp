@@ -5,6 +5,11 @@
  * the user. The RGB led operates by sending PWM signals to set the ratio of the
  * color (think RGB values for color).
  *
+ * RGB<R,G,B> drives its pins through Pin, resolved at compile time.
+ *
+ * When timed, animation frames are stepped from the Ticker interrupt, such
+ * that fades keep time under load, and run only picks the pattern.
+ *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
  */
@@ -12,45 +17,115 @@
 #define SRC_RGB_HPP_
 #include "types.hpp"
 #include "indicator.hpp"
+#include "animation.hpp"
+#include "pin.hpp"
+#include "ticker.hpp"
 //!< Number of colors in RGB led
-#define COLOR_COUNT 3
+#define COLOR_COUNT ANIMATION_CHANNELS
 //!< Red's index in arrays
 #define RED 0
 //!< Green's index in arrays
 #define GREEN 1
 //!< Blue's index in arrays
 #define BLUE 2
+//!< Run period of the RGB animation, one frame per run, and the frame period
+//!< when timed
+#define RGB_PERIOD_MS 10
+//!< Run period when timed, only picking the pattern
+#define RGB_TIMED_PERIOD_MS 50
+//!< Run phase of the RGB animation, keeps it off the button releases
+#define RGB_PHASE_MS 3
+//!< Time the LED fades back up to blue after a podium press
+#define RGB_PRESS_MS 3000
+//!< Time between waypoints of the rainbow, and blinks of the error
+#define RGB_WAYPOINT_MS 1000
 
-class RGB : public Indicator {
+class RGBBase : public Indicator {
     public:
         //Note: when resistors are installed, set to 0
         //!< Force PWM down by this power of 2 to prevent overload
         const int PWM_SHIFT = 2;
-        //!< Step size per interval roughly 1 waypoint per second
-        const int PWM_STEP = (255 * RATE_GROUP_PERIOD)/MS_PER_SECOND;
         /**
-         * Constructor to set the pins for the RGB leds.
+         * Constructor, starting dark.
+         * \param bool timed: step frames from the timer interrupt
+         */
+        RGBBase(bool timed);
+
+        /**
+         * Attach the frames to the Ticker, when timed. Only one RGB may be
+         * timed.
+         * \return true
          */
-        RGB(int rpin, int gpin, int bpin);
+        bool setup();
 
         /**
-         * Run every 1/N ms. Should display RED on error, or make one
-         * step to change color between this and the next step.
+         * Run every RGB_PERIOD_MS, or RGB_TIMED_PERIOD_MS when timed. Picks
+         * the pattern for the state, and steps it by a frame if not timed.
          */
         void run();
-    private:
-        //!< Waypoints for normal mode, will be subdivided into sets of 3
-        static const unsigned int POINTS[];
-        //!< Waypoints for error mode, will be subdivided into sets of 3
-        static const unsigned int ERROR_POINTS[];
-        //!< Count for pressed
-        unsigned int m_countdown;
 
-        //!< Pins to write to, in order to output color
-        int m_pin[COLOR_COUNT];
-        //!< Index of last waypoint reached
-        unsigned int m_index;
-        //!< Current R,G,B colors of the LED
-        unsigned int m_color[COLOR_COUNT];
+        /**
+         * Ticker handler stepping the frames of the timed RGB.
+         * \param uint8_t ms: milliseconds passed
+         */
+        static void tick(uint8_t ms);
+    protected:
+        /**
+         * Set the PWM duty of one color.
+         * \param unsigned int color: RED, GREEN, or BLUE
+         * \param uint8_t duty: duty cycle, 0-255
+         */
+        virtual void write(unsigned int color, uint8_t duty) = 0;
+    private:
+        /**
+         * Step the animation, and write out its color.
+         * \param uint16_t ms: time passed in ms
+         */
+        void frame(uint16_t ms);
+        //!< Rainbow shown while there are messages
+        static const Pattern PATTERN_RAINBOW;
+        //!< Blue flash and fade back up after a podium press
+        static const Pattern PATTERN_PRESS;
+        //!< Red blink on error
+        static const Pattern PATTERN_ERROR;
+        //!< Dark while there are no messages
+        static const Pattern PATTERN_OFF;
+        //!< Animation of the LED color
+        Animation m_animation;
+        //!< Stepping frames from the timer interrupt
+        bool m_timed;
+        //!< Time since the last frame, for the interrupt
+        uint8_t m_frame_ms;
+        //!< Timed RGB
+        static RGBBase* s_timed;
+};
+/**
+ * RGB led on the red, green, and blue PWM pins.
+ */
+template <uint8_t R, uint8_t G, uint8_t B>
+class RGB : public RGBBase {
+    public:
+        /**
+         * Set the pins up as PWM outputs.
+         * \param bool timed: step frames from the timer interrupt
+         */
+        RGB(bool timed = false) : RGBBase(timed) {
+            Pin<R>::output();
+            Pin<G>::output();
+            Pin<B>::output();
+            Pin<R>::pwm_enable();
+            Pin<G>::pwm_enable();
+            Pin<B>::pwm_enable();
+        }
+    protected:
+        void write(unsigned int color, uint8_t duty) {
+            if (color == RED) {
+                Pin<R>::pwm(duty);
+            } else if (color == GREEN) {
+                Pin<G>::pwm(duty);
+            } else {
+                Pin<B>::pwm(duty);
+            }
+        }
 };
 #endif /* SRC_RGB_HPP_ */
@@ -6,22 +6,29 @@
  *  Created on: Nov 11, 2018
  *      Author: lestarch
  */
-#include <Arduino.h>
+#include "hal.hpp"
 #include "runner.hpp"
-//Concrete definitions, forcing rollover
-uint32_t Runner::s_last = 0xFFFFFFFF;
+//Concrete definitions
+uint32_t Runner::s_last = 0;
 uint32_t Runner::s_current = 0;
+uint32_t Runner::s_start = 0;
 unsigned int Runner::s_count = 0;
 SerialPass* Runner::s_sleeper = NULL;
+Timing Runner::s_burn;
+uint16_t Runner::s_burn_overruns = 0;
 Runner* Runner::s_runners[MAX_RUNNERS];
 /**
- * Update the clock counter interval and last.
+ * Construct with the runner's rate. Release times are set on start.
  */
-void Runner::update_count() {
-    s_last = s_current;
-    s_current += RATE_GROUP_PERIOD;
-
-}
+Runner::Runner(uint16_t period, uint16_t phase) :
+    m_period(period),
+    m_phase(phase),
+    m_next(0),
+    m_last(0),
+    m_overruns(0),
+    m_missed(0),
+    m_late_max(0)
+{}
 /**
  * Check if given interval cbounds was crossed.
  */
@@ -53,40 +60,142 @@ void Runner::register_runners(Runner** runners, unsigned int count) {
     }
 }
 /**
- * Run a cycle and then wait for the next cycle
- * Note: this will undo the array
+ * Start the schedule, releasing each runner at its phase from now. The
+ * previous release is set one period before the first, such that interval
+ * checks see a clean first tick.
+ */
+void Runner::start() {
+    s_start = millis();
+    for (unsigned int i = 0; i < s_count && i < MAX_RUNNERS; i++) {
+        s_runners[i]->m_next = s_start + s_runners[i]->m_phase;
+        s_runners[i]->m_last = s_runners[i]->m_phase - s_runners[i]->m_period;
+    }
+}
+/**
+ * The first release is the next one of the runner's phase and period at or
+ * after now, keeping runners interleaved as their phases set out
+ */
+bool Runner::attach(Runner* runner) {
+    if (s_count >= MAX_RUNNERS || !runner->setup()) {
+        REPORT_ERROR("Runner setup error");
+        return false;
+    }
+    uint32_t since = millis() - s_start;
+    uint32_t first = runner->m_phase;
+    if (since > first) {
+        first += ((since - first + runner->m_period - 1) / runner->m_period) * runner->m_period;
+    }
+    runner->m_next = s_start + first;
+    runner->m_last = first - runner->m_period;
+    s_runners[s_count] = runner;
+    s_count++;
+    return true;
+}
+/**
+ * Run a cycle: dispatch the runner with the earliest release, sleeping until
+ * the release if it is not yet due.
  */
 void Runner::cycle() {
-    //Catch startup time
-    uint32_t last = millis();
-    update_count();
-    //Loop through all runners and cycle them
+    Runner* runner = NULL;
+    //Find the earliest release. Note: signed difference handles rollover
     for (unsigned int i = 0; i < s_count && i < MAX_RUNNERS; i++) {
-        s_runners[i]->run();
-        //Sleep partially to avoid long wait
-        (void) Runner::sleep((i + 1) * RATE_GROUP_PERIOD/s_count, last);
+        if (runner == NULL ||
+            static_cast<int32_t>(s_runners[i]->m_next - runner->m_next) < 0) {
+            runner = s_runners[i];
+        }
+    }
+    //Nothing registered, burn a default period
+    if (runner == NULL) {
+        (void) Runner::sleep(millis(), RATE_GROUP_PERIOD);
+        return;
     }
-    //Sleep to final end and report a rate group cycle overflow here
-    int32_t slip = Runner::sleep(RATE_GROUP_PERIOD, last);
-    if (slip > 0) {
-        char overflow[MAX_STR_LEN]; //Could optimize by copying
-        snprintf(overflow, MAX_STR_LEN, "Slip of %ldms", slip);
-        REPORT_ERROR(overflow);
+    //Sleep until release. A late runner skips any releases it missed, and
+    //the miss is counted against it
+    int32_t slip = Runner::sleep(runner->m_next, 0);
+    if (slip >= static_cast<int32_t>(runner->m_period)) {
+        uint32_t missed = slip / runner->m_period;
+        runner->m_next += missed * runner->m_period;
+        runner->m_missed += missed;
+        runner->m_overruns++;
     }
+    if (slip > runner->m_late_max) {
+        runner->m_late_max = (slip > 0xFFFF) ? 0xFFFF : slip;
+    }
+    //Publish the release window for interval checks, then run
+    s_last = runner->m_last;
+    s_current = runner->m_next - s_start;
+    uint32_t begin = micros();
+    runner->run();
+    runner->m_timing.record(micros() - begin);
+    runner->m_last = s_current;
+    runner->m_next += runner->m_period;
 }
 /**
  * Sleep duration implementation
  */
 int32_t Runner::sleep(uint32_t last, uint32_t duration) {
     //Wait for the next cycle, if needed
-    int32_t wait = ((int32_t)(last + duration) - (int32_t)millis());
+    int32_t wait = static_cast<int32_t>(last + duration - millis());
     //Sleep using sleeper, or delay if no sleeper defined
     if (wait > 0 && s_sleeper != NULL) {
+        uint32_t begin = micros();
         s_sleeper->run(wait);
+        uint32_t burn = micros() - begin;
+        s_burn.record(burn);
+        //Overran by more than the millisecond granularity of the request
+        if (burn > (static_cast<uint32_t>(wait) + 1) * MS_PER_SECOND) {
+            s_burn_overruns++;
+        }
         return 0;
     } else if (wait > 0) {
         delay(wait);
         return 0;
     }
-    return wait;
+    return -wait;
+}
+/**
+ * One report per runner, then the sleeper
+ */
+unsigned int Runner::report_count() {
+    return s_count + 1;
+}
+/**
+ * Print a report as "<TIMn ...>" where n is the runner index, or "S" for the
+ * sleeper. Runners report their overrun counters ahead of the timings.
+ */
+void Runner::report(Print& out, unsigned int index) {
+    out.print(F("<TIM"));
+    if (index < s_count && index < MAX_RUNNERS) {
+        Runner* runner = s_runners[index];
+        out.print(index);
+        out.print(F(" per="));
+        out.print(runner->m_period);
+        out.print(F(" ovr="));
+        out.print(runner->m_overruns);
+        out.print(F(" miss="));
+        out.print(runner->m_missed);
+        out.print(F(" late="));
+        out.print(runner->m_late_max);
+        out.print(' ');
+        runner->m_timing.report(out);
+    } else {
+        out.print(F("S ovr="));
+        out.print(s_burn_overruns);
+        out.print(' ');
+        s_burn.report(out);
+    }
+    out.println('>');
+}
+/**
+ * Clear everything counted so far
+ */
+void Runner::reset_telemetry() {
+    for (unsigned int i = 0; i < s_count && i < MAX_RUNNERS; i++) {
+        s_runners[i]->m_timing.clear();
+        s_runners[i]->m_overruns = 0;
+        s_runners[i]->m_missed = 0;
+        s_runners[i]->m_late_max = 0;
+    }
+    s_burn.clear();
+    s_burn_overruns = 0;
 }
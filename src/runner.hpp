@@ -1,11 +1,20 @@
 /*
  * runner.hpp:
  *
- * Runner class which defines one function "run". This run function will be
- * called at a fixed rate: 1/Nms. Thus the implementor can perform updates
- * at 1/ms. Nothing done in the "run" function should ever take a long time to
- * execute, but rather should just update state (quickly). N is set to:
- * RATE_GROUP_PERIOD milliseconds.
+ * Runner class which defines one function "run". Each runner declares its own
+ * period and phase, and the run function will be called at that rate: once
+ * every period milliseconds, offset by phase milliseconds from the start of
+ * the schedule. Nothing done in the "run" function should ever take a long
+ * time to execute, but rather should just update state (quickly). Runners
+ * that do not declare a period run every RATE_GROUP_PERIOD milliseconds.
+ *
+ * Runners are dispatched in deadline order: the runner with the earliest
+ * release time runs next, and any idle time before that release is handed to
+ * the registered sleeper (the serial passthrough).
+ *
+ * Every run call and every sleeper burn window is timed. Late dispatches are
+ * counted as overruns rather than reported as errors, and all of it can be
+ * printed out on request without disturbing the error state.
  *
  *  Created on: Nov 9, 2018
  *      Author: lestarch
@@ -15,15 +24,23 @@
 #define SRC_RUNNER_HPP_
 #include "types.hpp"
 #include "serial.hpp"
-//!< Rate-group period. Run functions called every N-ms.
-//!< Currently set to one, as serial sends roughly 1char/ms
+#include "timing.hpp"
+//!< Default rate-group period. Run functions called every N-ms, unless the
+//!< runner declares its own period.
 #define RATE_GROUP_PERIOD 100
 class Runner {
     public:
         /**
-         * Runs a single update. Will be called on a 1ms interval. This means
+         * Constructs the runner with its period and phase.
+         * \param uint16_t period: milliseconds between calls to run
+         * \param uint16_t phase: offset of first call from schedule start
+         */
+        Runner(uint16_t period = RATE_GROUP_PERIOD, uint16_t phase = 0);
+        /**
+         * Runs a single update. Will be called once every period. This means
          * that no long-running task should be done, but rather work should be
-         * broken up into 1/Nms steps. Default implementation: do no work.
+         * broken up into period sized steps. Default implementation: do no
+         * work.
          */
         virtual void run() {};
         /**
@@ -54,7 +71,21 @@ class Runner {
          */
         static void setup_all(Runner* runners[], unsigned int count);
         /**
-         * Run a cycle of the system.
+         * Start the schedule. Each registered runner is released first at its
+         * phase past the current time. Must be called before cycle.
+         */
+        static void start();
+        /**
+         * Set up and register a runner once the schedule has started. It is
+         * released first at its next phase in the schedule, as if it had been
+         * registered from the start.
+         * \param Runner* runner: runner to set up and register
+         * \return true if registered, false if setup failed or there is no room
+         */
+        static bool attach(Runner* runner);
+        /**
+         * Run a cycle of the system. This dispatches the registered runner
+         * with the earliest release, sleeping until that release if needed.
          */
         static void cycle();
         /**
@@ -65,28 +96,64 @@ class Runner {
          */
         static int32_t sleep(uint32_t last, uint32_t duration);
         /**
-         * Updates the static counters s_count and s_last, in order to power
-         * the interval check call.
-         */
-        static void update_count();
-        /**
-         * Interval check. Checks to see if a clock running at the given interval
-         * has ticked in the last cycle.
+         * Interval check. Checks to see if a clock running at the given
+         * interval has ticked between the previous and current release of the
+         * runner that is currently running.
          * \param unsigned int interval: interval to check
          * \return true if a clock cycle ticked in last interval
          */
         static bool interval_check(unsigned int interval);
+        /**
+         * Number of telemetry reports available. One per registered runner,
+         * followed by one for the sleeper.
+         * \return count of reports
+         */
+        static unsigned int report_count();
+        /**
+         * Print one telemetry report as a single framed line. Runners are
+         * numbered in registration order.
+         * \param Print& out: output to print to
+         * \param unsigned int index: report to print, less than report_count
+         */
+        static void report(Print& out, unsigned int index);
+        /**
+         * Clear all telemetry counters and statistics.
+         */
+        static void reset_telemetry();
         //Virtual destructor required, but no work needed.
         virtual ~Runner() {};
+    protected:
+        //!< Period between releases in milliseconds
+        uint16_t m_period;
+        //!< Offset of the first release in milliseconds
+        uint16_t m_phase;
+        //!< Next release time from millis
+        uint32_t m_next;
+        //!< Previous release, relative to schedule start
+        uint32_t m_last;
+        //!< Execution time of run
+        Timing m_timing;
+        //!< Dispatches that missed at least one release
+        uint16_t m_overruns;
+        //!< Releases skipped due to overruns
+        uint16_t m_missed;
+        //!< Worst dispatch lateness in milliseconds
+        uint16_t m_late_max;
     private:
-        //!< Current millisecond clock count
+        //!< Release of the running runner, relative to schedule start
         static uint32_t s_current;
-        //!< Current last clock count
+        //!< Previous release of the running runner
         static uint32_t s_last;
+        //!< Schedule start time from millis
+        static uint32_t s_start;
         //!< Current runner count
         static unsigned int s_count;
         //!< Sleeper used to burn time
         static SerialPass* s_sleeper;
+        //!< Length of sleeper burn windows
+        static Timing s_burn;
+        //!< Burn windows that ran past their requested end
+        static uint16_t s_burn_overruns;
         //!< Current set of runners
         static Runner* s_runners[MAX_RUNNERS];
 };
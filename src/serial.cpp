@@ -8,115 +8,749 @@
  */
 #include "serial.hpp"
 #include "indicator.hpp"
+#include "runner.hpp"
+#include "button.hpp"
+#include "boot.hpp"
 #include <string.h>
+//Initialize static pointer
+SerialPass* SerialPass::s_instance = NULL;
+/**
+ * Receiver for use in the host receive interrupt
+ */
+bool serial_receive(uint8_t byte) {
+    return SerialPass::s_instance->deframe(byte);
+}
+/**
+ * Receiver for use in the matrix receive interrupt
+ */
+bool serial_forward(uint8_t byte) {
+    return SerialPass::s_instance->forward(byte);
+}
+/**
+ * Value of a two digit frame field, or MATRIX_UNKNOWN if not digits
+ */
+static uint8_t field(const char* digits) {
+    if (digits[0] < '0' || digits[0] > '9' || digits[1] < '0' || digits[1] > '9') {
+        return MATRIX_UNKNOWN;
+    }
+    return (digits[0] - '0') * 10 + (digits[1] - '0');
+}
+/**
+ * Write a value as a two digit frame field
+ */
+static void digits(char* field, uint8_t value) {
+    field[0] = '0' + (value / 10) % 10;
+    field[1] = '0' + value % 10;
+}
+/**
+ * Bit at a time, high bit first
+ */
+uint16_t crc16(uint16_t crc, uint8_t byte) {
+    crc ^= static_cast<uint16_t>(byte) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? ((crc << 1) ^ BINARY_CRC_POLY) : (crc << 1);
+    }
+    return crc;
+}
 /**
  * Construction done via references, to ensure saftey and memory.
  */
-SerialPass::SerialPass(HardwareSerial& in, SoftwareSerial& out) :
+SerialPass::SerialPass(HostSerial& in, MatrixSerial& out, uint16_t timeout) :
     m_in(in),
     m_out(out),
     m_cmd_index(0),
-    m_response_count(0),
     m_state(IDLE),
-    m_interrupt(false)
+    m_command(false),
+    m_binary(false),
+    m_reporting(false),
+    m_frame_index(0),
+    m_divert(false),
+    m_pending_head(0),
+    m_pending_tail(0),
+    m_reply_index(0),
+    m_reply_last(0),
+    m_reply_value(0),
+    m_reply_output(0),
+    m_fresh(false),
+    m_syncs(0),
+    m_syncs_seen(0),
+    m_synced_time(0),
+    m_synced(false),
+    m_cache_age(MATRIX_CACHE_MS),
+    m_refresh(MATRIX_REFRESH_MS),
+    m_refresh_time(0),
+    m_local(0),
+    m_requests(0),
+    m_requests_seen(0),
+    m_request_time(0),
+    m_switched(0),
+    m_skipped(0),
+    m_matched(0),
+    m_unexpected(0),
+    m_timeouts(0),
+    m_resyncs(0),
+    m_progress(0),
+    m_progress_seen(0),
+    m_progress_time(0),
+    m_timeout(timeout),
+    m_binary_length(0),
+    m_binary_sequence(0),
+    m_binary_crc(0),
+    m_binary_progress(0),
+    m_binary_seen(0),
+    m_binary_time(0),
+    m_acking(false),
+    m_applied_crc(0),
+    m_applied_valid(false),
+    m_crc_errors(0),
+    m_handler(NULL),
+    m_report(REPORT_NONE)
 {
     memcpy(m_matrix, MATRIX_TEMPLATE_STR, sizeof(m_matrix));
+    for (unsigned int i = 0; i < MATRIX_OUTPUTS; i++) {
+        m_targets[i] = MATRIX_UNKNOWN;
+    }
+    for (unsigned int i = 0; i < MAX_SERIAL; i++) {
+        m_activity[i] = 0;
+        m_activity_seen[i] = 0;
+    }
 }
 /**
- * Begin the serial device
+ * Set before begin, or from the main loop
  */
-void SerialPass::begin(int baud) {
-    m_in.begin(baud);
-    m_out.begin(baud);
+void SerialPass::cache(uint16_t age, uint16_t refresh) {
+    m_cache_age = age;
+    m_refresh = refresh;
+}
+void SerialPass::register_handler(SerialHandle handler) {
+    m_handler = handler;
 }
 /**
- * Interrupted, toggle
+ * Begin the serial device, deframing from the receive interrupt
  */
-void SerialPass::interrupt() {
-    m_interrupt = true;
+void SerialPass::begin(unsigned long baud) {
+    m_in.begin(baud);
+    m_out.begin(baud);
+    SerialPass::s_instance = this;
+    m_in.set_receiver(serial_receive);
+    m_out.set_receiver(serial_forward);
 }
 /**
- * Run the serial pass-through and deframer
+ * Run the rest of the serial pass-through: held host bytes, control frames,
+ * reports, and matrix responses
  */
 void SerialPass::run(uint32_t wait) {
     uint32_t ending = wait + millis();
     //Loop for the time reading and writing
     while (millis() < ending) {
-        // Handle podium presses before passthrough
-        if (m_interrupt && m_state == IDLE) {
-            toggle();
-            m_interrupt = false;
-        }
-        //While waiting for a response, don't read character
-        int character = -1;
-        if (m_state != RESP) {
-            character = m_in.read();
-        }
-        //Handle operations in normal mode (sending matrix data)
-        if (m_state == IDLE) {
-            //Read a start character, switch to command mode
-            if (static_cast<char>(character) == START_CMD) {
-                m_state = COMMAND;
-                m_cmd_index = 0;
+        // Handle button presses and routing requests before passthrough
+        ButtonBase::dispatch();
+        dispatch();
+        //Deframe host bytes the interrupt left buffered, stopping at the first
+        //one that still cannot be taken
+        bool taken = true;
+        while (taken && m_in.available() > 0) {
+            noInterrupts();
+            int character = m_in.peek();
+            taken = (character != -1) && deframe(static_cast<uint8_t>(character));
+            if (taken) {
+                m_in.read();
             }
-            //Handle 'M' characters the other possible token
-            else if (static_cast<char>(character) == 'M') {
-                m_state = MSG1;
-                m_out.write(static_cast<uint8_t>(character));
+            interrupts();
+        }
+        //Parse completed command data, freeing it for the next frame. Text
+        //data is terminated, and a short key padded out, by clearing the rest.
+        //Binary frames wait for the last one's acknowledgement to go out.
+        if (m_command && m_binary && !m_acking) {
+            binary();
+            m_binary = false;
+            m_command = false;
+        } else if (m_command && !m_binary) {
+            memset(m_cmd + m_cmd_index, 0, sizeof(m_cmd) - m_cmd_index);
+            if (static_cast<char>(m_cmd[0]) == QUERY_CMD) {
+                query(m_cmd);
+            } else {
+                Indicator::message(reinterpret_cast<const char*>(m_cmd),
+                                   reinterpret_cast<const char*>(m_cmd + MAX_KEY_LEN));
             }
+            m_command = false;
+        }
+        //Print acknowledgements, then pending reports a line at a time, once
+        //host output drains, and between replies, holding replies back
+        if (m_state == IDLE && (m_acking || m_report != REPORT_NONE) &&
+            m_in.availableForWrite() >= REPORT_TX_SPACE) {
+            noInterrupts();
+            m_reporting = (m_reply_index == 0);
+            interrupts();
         }
-        // Messaging states
-        else if (m_state == MSG1 || m_state == MSG2) {
-            //Handle 'T' character states, second one is done
-            if (static_cast<char>(character) == 'T' && m_state == MSG1) {
-                m_state = MSG2;
-            } else if (static_cast<char>(character) == 'R' && m_state == MSG2) {
-                //Expected a response if this is a read
-                m_response_count = RESPONSE_SIZE;
-            } else if (static_cast<char>(character) == 'T' && m_state == MSG2) {
-                m_state = RESP;
+        if (m_reporting) {
+            if (m_acking) {
+                acknowledge();
+                m_acking = false;
+            } else if (m_report == REPORT_SERIAL) {
+                report();
+                m_report = REPORT_NONE;
+            } else if (m_report == REPORT_BUTTON) {
+                ButtonBase::report(m_in);
+                m_report = REPORT_NONE;
+            } else if (m_report == REPORT_BOOT) {
+                Boot::report(m_in);
+                m_report = REPORT_NONE;
+            } else {
+                Runner::report(m_in, m_report);
+                m_report++;
+                if (m_report >= Runner::report_count()) {
+                    m_report = REPORT_NONE;
+                }
             }
-            m_out.write(static_cast<uint8_t>(character));             
-        }
-        //Command mode, read data and store for parsing
-        else if (m_state == COMMAND) {
-            //Termination of command mode, parse stored data
-            if (static_cast<char>(character) == END_CMD) {
-                m_state = IDLE;
-                Indicator::message(m_cmd, m_cmd + MAX_KEY_LEN);
+            m_reporting = false;
+        }
+        freshen();
+        //Forward matrix bytes the interrupt left buffered
+        taken = true;
+        while (taken && m_out.available() > 0) {
+            noInterrupts();
+            int character = m_out.peek();
+            taken = (character != -1) && forward(static_cast<uint8_t>(character));
+            if (taken) {
+                m_out.read();
             }
-            //Store valid data
-            else if (character != -1 && m_cmd_index < (MAX_STR_LEN + MAX_KEY_LEN)) {
-                m_cmd[m_cmd_index] = static_cast<uint8_t>(character);
-                m_cmd_index++;
+            interrupts();
+        }
+        expire();
+        //Report activity once a batch, outside the interrupts. Counts are a
+        //byte each, read whole.
+        for (uint8_t i = 0; i < MAX_SERIAL; i++) {
+            uint8_t activity = m_activity[i];
+            if (activity != m_activity_seen[i]) {
+                m_activity_seen[i] = activity;
+                if (m_handler != NULL) {
+                    m_handler(static_cast<SerialType>(i));
+                }
             }
         }
-        // Handle response counting back
-        else if (m_state == RESP) {
-            if (m_response_count == 0) {
-                m_state = IDLE;
+    }
+}
+/**
+ * Progress is only seen at loop rate, so a read is given up on between the
+ * timeout and the timeout plus the longest runner after its last progress.
+ */
+void SerialPass::expire() {
+    uint16_t now = static_cast<uint16_t>(millis());
+    noInterrupts();
+    //Reads answered locally wait on the host, not the matrix
+    if (m_progress != m_progress_seen || m_pending_head == m_pending_tail ||
+        head() == PENDING_LOCAL) {
+        m_progress_seen = m_progress;
+        m_progress_time = now;
+    } else if (static_cast<uint16_t>(now - m_progress_time) >= m_timeout) {
+        m_pending_tail = m_pending_tail + 1;
+        m_timeouts++;
+        m_progress_time = now;
+        //Whatever came of the reply was cut short
+        if (m_reply_index != 0) {
+            m_reply_index = 0;
+            m_resyncs++;
+        }
+    }
+    //A binary frame gone quiet was a stray start or lost a byte, so stop
+    //swallowing what follows it
+    if (m_binary_progress != m_binary_seen || m_state != BINARY) {
+        m_binary_seen = m_binary_progress;
+        m_binary_time = now;
+    } else if (static_cast<uint16_t>(now - m_binary_time) >= BINARY_GAP_MS) {
+        m_state = IDLE;
+        m_resyncs++;
+    }
+    interrupts();
+}
+/**
+ * The model only ages at loop rate, so reads may be answered locally up to the
+ * longest runner past the cache age.
+ */
+void SerialPass::freshen() {
+    uint16_t now = static_cast<uint16_t>(millis());
+    if (m_syncs != m_syncs_seen) {
+        m_syncs_seen = m_syncs;
+        m_synced_time = now;
+        m_synced = true;
+    }
+    //Latched, such that the time since cannot wrap back into the age
+    if (static_cast<uint16_t>(now - m_synced_time) >= m_cache_age) {
+        m_synced = false;
+    }
+    m_fresh = m_synced && m_model.complete();
+    //Answer the oldest read from the model. Matrix bytes are held back while
+    //it waits, so no reply can be part way through.
+    if (m_pending_head != m_pending_tail && head() == PENDING_LOCAL &&
+        m_in.availableForWrite() >= MATRIX_REPLY_SIZE) {
+        m_model.reply(m_in);
+        noInterrupts();
+        m_pending_tail = m_pending_tail + 1;
+        m_progress++;
+        interrupts();
+        m_local++;
+    }
+    //Refresh the model between host frames, once no reads are in flight
+    if (m_refresh != 0 && static_cast<uint16_t>(now - m_refresh_time) >= m_refresh) {
+        const char frame[] = MATRIX_READ_FRAME;
+        noInterrupts();
+        if (m_state == IDLE && m_pending_head == m_pending_tail &&
+            m_out.availableForWrite() >= static_cast<int>(sizeof(frame) - 1)) {
+            for (unsigned int i = 0; i < sizeof(frame) - 1; i++) {
+                m_out.push(static_cast<uint8_t>(frame[i]));
+                m_activity[SERIAL_MATRIX] = m_activity[SERIAL_MATRIX] + 1;
             }
+            await(MATRIX_ROUTES_CODE, PENDING_REFRESH);
+            m_refresh_time = now;
         }
-        else {
-            ASSERT(false, "Invalid serial state");
+        interrupts();
+    }
+}
+void SerialPass::await(const char* code, PendingKind kind) {
+    uint8_t slot = m_pending_head & (MATRIX_PENDING - 1);
+    m_pending[slot][0] = code[0];
+    m_pending[slot][1] = code[1];
+    m_pending_kind[slot] = kind;
+    m_pending_head = m_pending_head + 1;
+}
+PendingKind SerialPass::head() const {
+    if (m_pending_head == m_pending_tail) {
+        return PENDING_MATRIX;
+    }
+    return static_cast<PendingKind>(m_pending_kind[m_pending_tail & (MATRIX_PENDING - 1)]);
+}
+/**
+ * Pass a matrix byte back to the host, unless a report line is being printed.
+ * Bytes wait while a read ahead of them is answered locally, and replies to
+ * refreshes only go to the model.
+ */
+bool SerialPass::forward(uint8_t byte) {
+    PendingKind kind = head();
+    if (m_reporting || kind == PENDING_LOCAL) {
+        return false;
+    }
+    if (kind != PENDING_REFRESH) {
+        if (!m_in.push(byte)) {
+            return false;
         }
-        //Pass-through the returned UART message
-        character = m_out.read();
-        if (character != -1) {
-            m_in.write(static_cast<uint8_t>(character));
-            if (m_response_count > 0) {
-                m_response_count = m_response_count - 1;
+        m_activity[SERIAL_USB] = m_activity[SERIAL_USB] + 1;
+    }
+    reply(byte);
+    return true;
+}
+/**
+ * Replies start with 'M' and end with "NT", with the command code at the same
+ * offset as in the request. Bytes between replies are passed on unparsed.
+ * Route read replies update the model route by route, as output then input
+ * digit pairs.
+ */
+void SerialPass::reply(uint8_t byte) {
+    char character = static_cast<char>(byte);
+    //A frame start within a reply, or an overlong reply, cuts it short
+    if (m_reply_index != 0 && (character == 'M' || m_reply_index >= MATRIX_REPLY_MAX)) {
+        m_reply_index = 0;
+        m_resyncs++;
+    }
+    if (m_reply_index == 0 && character != 'M') {
+        return;
+    }
+    m_progress++;
+    if (m_reply_index >= MATRIX_CODE_OFFSET && m_reply_index < (MATRIX_CODE_OFFSET + 2)) {
+        m_reply_code[m_reply_index - MATRIX_CODE_OFFSET] = character;
+    }
+    bool routes = (m_reply_code[0] == MATRIX_ROUTES_CODE[0] &&
+                   m_reply_code[1] == MATRIX_ROUTES_CODE[1]);
+    if (routes && m_reply_index >= MATRIX_HEADER_SIZE && character >= '0' && character <= '9') {
+        uint8_t digit = character - '0';
+        switch ((m_reply_index - MATRIX_HEADER_SIZE) & 0x3) {
+            case 0:
+            case 2:
+                m_reply_value = digit * 10;
+                break;
+            case 1:
+                m_reply_output = m_reply_value + digit;
+                break;
+            default:
+                m_model.route(m_reply_output, m_reply_value + digit);
+                break;
+        }
+    }
+    m_reply_index = (m_reply_index < 0xFF) ? (m_reply_index + 1) : m_reply_index;
+    //Complete reply, match it to the oldest pending read
+    if (character == 'T' && m_reply_last == 'N' && m_reply_index > (MATRIX_CODE_OFFSET + 2)) {
+        const char* code = m_pending[m_pending_tail & (MATRIX_PENDING - 1)];
+        if (m_pending_tail != m_pending_head &&
+            code[0] == m_reply_code[0] && code[1] == m_reply_code[1]) {
+            m_pending_tail = m_pending_tail + 1;
+            m_matched++;
+            m_progress++;
+            m_syncs = m_syncs + (routes ? 1 : 0);
+        } else {
+            m_unexpected++;
+        }
+        m_reply_index = 0;
+    }
+    m_reply_last = character;
+}
+/**
+ * Deframe a host byte from the grammar's tables. Hooks refusing the byte leave
+ * the state as it was, for the byte to be offered again.
+ */
+bool SerialPass::deframe(uint8_t byte) {
+    uint8_t type = pgm_read_byte(DeframeClassTable::TABLE + byte);
+    uint8_t step = pgm_read_byte(DeframeTransitionTable::TABLE + m_state * DEFRAME_CLASSES + type);
+    SerialState next = static_cast<SerialState>(step & DEFRAME_STATE_MASK);
+    switch (step >> DEFRAME_STATE_BITS) {
+        case ACTION_OPEN_COMMAND:
+            //Once the last command's data has been parsed
+            if (m_command) {
+                return false;
             }
+            m_cmd_index = 0;
+            break;
+        case ACTION_OPEN_BINARY:
+            if (m_command) {
+                return false;
+            }
+            m_frame_index = 0;
+            m_binary_progress = m_binary_progress + 1;
+            break;
+        case ACTION_OPEN_MATRIX:
+            open();
+            break;
+        case ACTION_CAPTURE:
+            capture(byte);
+            break;
+        case ACTION_COUNT:
+            //A new start cuts the unterminated command short
+            m_cmd_index = 0;
+            m_resyncs++;
+            break;
+        case ACTION_EMIT:
+            m_command = true;
+            break;
+        case ACTION_FORWARD:
+        case ACTION_FORWARD_END:
+            return relay(byte, next);
+        case ACTION_BINARY:
+            take(byte);
+            return true;
+        default:
+            break;
+    }
+    m_state = next;
+    return true;
+}
+void SerialPass::open() {
+    m_header[0] = MATRIX_START;
+    m_header[MATRIX_CODE_OFFSET] = '\0';
+    m_header[MATRIX_CODE_OFFSET + 1] = '\0';
+    m_frame_index = 1;
+    m_divert = false;
+}
+void SerialPass::capture(uint8_t byte) {
+    if (m_cmd_index < (MAX_STR_LEN + MAX_KEY_LEN)) {
+        m_cmd[m_cmd_index] = byte;
+        m_cmd_index++;
+    }
+}
+/**
+ * Matrix bytes are only forwarded once there is room for them, and the state
+ * only moves on once the byte is taken. Frame headers are held back until the
+ * command code shows whether the model answers the frame.
+ */
+bool SerialPass::relay(uint8_t byte, SerialState next) {
+    char character = static_cast<char>(byte);
+    bool end = (m_state == MSG2 && next == IDLE);
+    const char* code = m_header + MATRIX_CODE_OFFSET;
+    bool read = (code[0] == MATRIX_READ_CMD);
+    uint8_t pending = m_pending_head - m_pending_tail;
+    //Hold the end of a read until there is a slot to await its reply
+    if (end && read && pending >= MATRIX_PENDING) {
+        return false;
+    }
+    if (m_frame_index < MATRIX_HEADER_SIZE) {
+        m_header[m_frame_index] = character;
+        //Header complete, or the frame ended early: answer route reads
+        //locally while the model is fresh, and send the rest on
+        if (end || m_frame_index == (MATRIX_HEADER_SIZE - 1)) {
+            m_divert = !end && m_fresh &&
+                       code[0] == MATRIX_ROUTES_CODE[0] && code[1] == MATRIX_ROUTES_CODE[1];
+            if (!m_divert && !flush(m_frame_index + 1)) {
+                return false;
+            }
+        }
+    } else if (!m_divert) {
+        if (!m_out.push(byte)) {
+            return false;
+        }
+        m_activity[SERIAL_MATRIX] = m_activity[SERIAL_MATRIX] + 1;
+        Boot::forwarded();
+    }
+    if (m_frame_index >= MATRIX_HEADER_SIZE &&
+        m_frame_index < (MATRIX_HEADER_SIZE + MATRIX_PARAM_SIZE)) {
+        m_param[m_frame_index - MATRIX_HEADER_SIZE] = character;
+    }
+    m_frame_index = (m_frame_index < 0xFF) ? (m_frame_index + 1) : m_frame_index;
+    //An overlong frame was never a frame, drop back to looking for one
+    if (m_frame_index > MATRIX_FRAME_MAX) {
+        m_state = IDLE;
+        m_resyncs++;
+        return true;
+    }
+    if (end) {
+        //Reads await a reply, without holding up the frames behind them
+        if (read) {
+            await(code, m_divert ? PENDING_LOCAL : PENDING_MATRIX);
+        }
+        //Switch commands set the route the model answers with
+        else if (code[0] == MATRIX_SWITCH_CMD &&
+                 m_frame_index > (MATRIX_HEADER_SIZE + MATRIX_PARAM_SIZE)) {
+            m_model.route(field(m_param + 2), field(m_param));
+        }
+    }
+    m_state = next;
+    return true;
+}
+/**
+ * Binary frame: length, sequence, payload, then CRC. A length past the
+ * longest payload was never a frame, drop back to looking for one.
+ */
+void SerialPass::take(uint8_t byte) {
+    m_binary_progress = m_binary_progress + 1;
+    if (m_frame_index == 0) {
+        m_binary_length = byte;
+        if (byte > BINARY_PAYLOAD_MAX) {
+            m_state = IDLE;
+            m_resyncs++;
+        }
+    } else if (m_frame_index == 1) {
+        m_binary_sequence = byte;
+    } else if (m_frame_index < (m_binary_length + 2)) {
+        m_cmd[m_frame_index - 2] = byte;
+    } else if (m_frame_index == (m_binary_length + 2)) {
+        m_binary_crc = static_cast<uint16_t>(byte) << 8;
+    } else {
+        m_binary_crc |= byte;
+        m_state = IDLE;
+        m_binary = true;
+        m_command = true;
+    }
+    m_frame_index++;
+}
+bool SerialPass::flush(uint8_t count) {
+    if (m_out.availableForWrite() < count) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        m_out.push(static_cast<uint8_t>(m_header[i]));
+        m_activity[SERIAL_MATRIX] = m_activity[SERIAL_MATRIX] + 1;
+        Boot::forwarded();
+    }
+    return true;
+}
+/**
+ * Answer queries. Reports are printed from run, so they never hold up the
+ * passthrough for longer than a line.
+ */
+void SerialPass::query(const uint8_t* key) {
+    const char* name = reinterpret_cast<const char*>(key);
+    if (strncmp(name, QUERY_TIMING, MAX_KEY_LEN) == 0) {
+        m_report = 0;
+    } else if (strncmp(name, QUERY_SERIAL, MAX_KEY_LEN) == 0) {
+        m_report = REPORT_SERIAL;
+    } else if (strncmp(name, QUERY_BUTTON, MAX_KEY_LEN) == 0) {
+        m_report = REPORT_BUTTON;
+    } else if (strncmp(name, QUERY_BOOT, MAX_KEY_LEN) == 0) {
+        m_report = REPORT_BOOT;
+    } else if (strncmp(name, QUERY_TIMING_RESET, MAX_KEY_LEN) == 0) {
+        Runner::reset_telemetry();
+        ButtonBase::reset_telemetry();
+        m_matched = 0;
+        m_unexpected = 0;
+        m_timeouts = 0;
+        m_resyncs = 0;
+        m_local = 0;
+        m_switched = 0;
+        m_skipped = 0;
+        m_crc_errors = 0;
+    }
+}
+/**
+ * Records are checked through before any is applied, so a malformed frame
+ * changes nothing. Values are as long as their type needs: a text message
+ * fits the store, an address is 4 bytes, a number 1 to 4, and a query none.
+ */
+void SerialPass::binary() {
+    uint16_t crc = crc16(crc16(BINARY_CRC_INIT, m_binary_length), m_binary_sequence);
+    for (uint8_t i = 0; i < m_binary_length; i++) {
+        crc = crc16(crc, m_cmd[i]);
+    }
+    m_acking = true;
+    m_ack.sequence = m_binary_sequence;
+    if (crc != m_binary_crc) {
+        m_ack.status = BINARY_ACK_CRC;
+        m_ack.count = 0;
+        m_crc_errors++;
+        return;
+    }
+    //A resend of the last frame applied, its acknowledgement was lost
+    if (m_applied_valid && m_applied.sequence == m_binary_sequence && m_applied_crc == m_binary_crc) {
+        m_ack = m_applied;
+        return;
+    }
+    m_ack.status = BINARY_ACK_OK;
+    m_ack.count = 0;
+    for (uint8_t index = 0; index < m_binary_length; m_ack.count++) {
+        uint8_t op = m_cmd[index] >> BINARY_OP_SHIFT;
+        uint8_t length = m_cmd[index] & BINARY_LENGTH_MASK;
+        index += 1 + MAX_KEY_LEN + length;
+        if (index > m_binary_length ||
+            (op == BINARY_OP_TEXT && length > MAX_STR_LEN) ||
+            (op == BINARY_OP_ADDRESS && length != 4) ||
+            (op == BINARY_OP_NUMBER && (length < 1 || length > 4)) ||
+            (op == BINARY_OP_QUERY && length != 0)) {
+            m_ack.status = BINARY_ACK_MALFORMED;
+            m_ack.count = 0;
+            return;
+        }
+    }
+    for (uint8_t index = 0; index < m_binary_length;) {
+        uint8_t op = m_cmd[index] >> BINARY_OP_SHIFT;
+        uint8_t length = m_cmd[index] & BINARY_LENGTH_MASK;
+        const char* key = reinterpret_cast<const char*>(m_cmd + index + 1);
+        const uint8_t* data = m_cmd + index + 1 + MAX_KEY_LEN;
+        StoreValue value;
+        if (op == BINARY_OP_TEXT) {
+            Indicator::message(key, reinterpret_cast<const char*>(data), length);
+        } else if (op == BINARY_OP_ADDRESS) {
+            memcpy(value.address, data, sizeof(value.address));
+            Indicator::message(key, STORE_ADDRESS, value);
+        } else if (op == BINARY_OP_NUMBER) {
+            //Sign extend from the top byte sent
+            uint32_t number = 0;
+            for (uint8_t i = length; i > 0; i--) {
+                number = (number << 8) | data[i - 1];
+            }
+            uint8_t shift = 8 * (4 - length);
+            value.number = static_cast<int32_t>(number << shift) >> shift;
+            Indicator::message(key, STORE_NUMBER, value);
+        } else {
+            query(m_cmd + index + 1);
         }
+        index += 1 + MAX_KEY_LEN + length;
     }
+    m_applied = m_ack;
+    m_applied_crc = m_binary_crc;
+    m_applied_valid = true;
+}
+void SerialPass::acknowledge() {
+    uint8_t frame[BINARY_OVERHEAD + BINARY_ACK_SIZE] = {
+        BINARY_START, BINARY_ACK_SIZE, m_ack.sequence, m_ack.status, m_ack.count, 0, 0
+    };
+    uint16_t crc = BINARY_CRC_INIT;
+    for (uint8_t i = 1; i < (sizeof(frame) - 2); i++) {
+        crc = crc16(crc, frame[i]);
+    }
+    frame[sizeof(frame) - 2] = static_cast<uint8_t>(crc >> 8);
+    frame[sizeof(frame) - 1] = static_cast<uint8_t>(crc);
+    m_in.write(frame, sizeof(frame));
+}
+/**
+ * Reads in flight, replies matched and unexpected, reads answered locally, and
+ * routing requests sent and skipped
+ */
+void SerialPass::report() {
+    m_in.print(F("<SER pend="));
+    m_in.print(static_cast<uint8_t>(m_pending_head - m_pending_tail));
+    m_in.print(F(" match="));
+    m_in.print(m_matched);
+    m_in.print(F(" unexp="));
+    m_in.print(m_unexpected);
+    m_in.print(F(" tmo="));
+    m_in.print(m_timeouts);
+    m_in.print(F(" sync="));
+    m_in.print(m_resyncs);
+    m_in.print(F(" local="));
+    m_in.print(m_local);
+    m_in.print(F(" sw="));
+    m_in.print(m_switched);
+    m_in.print(F(" skip="));
+    m_in.print(m_skipped);
+    m_in.print(F(" crc="));
+    m_in.print(m_crc_errors);
+    m_in.println(F(">"));
 }
 /**
- * Toggle the devices.
+ * Each request is a single byte write, which run takes with interrupts off.
  */
-void SerialPass :: toggle() {
-        //Singleton pointer to the active device
-        static char active = 0;
-        m_matrix[7] = active + '1';
-        m_out.write(m_matrix, sizeof(m_matrix));
-        active = (active + 1) % MAX_MATRIX;
+void SerialPass::request(uint8_t output, uint8_t input) {
+    if (output < 1 || output > MATRIX_OUTPUTS) {
+        return;
+    }
+    m_targets[output - 1] = input;
+    m_requests = m_requests + 1;
+}
+uint8_t SerialPass::target(uint8_t output) const {
+    if (output < 1 || output > MATRIX_OUTPUTS) {
+        return MATRIX_UNKNOWN;
+    }
+    uint8_t input = m_targets[output - 1];
+    return (input != MATRIX_UNKNOWN) ? input : m_model.input(output);
+}
+/**
+ * The model is not marked fresh, so reads still go to the matrix until it
+ * replies. Only outputs not yet known take the route.
+ */
+void SerialPass::restore(uint8_t output, uint8_t input) {
+    if (input >= 1 && input <= MATRIX_INPUTS && m_model.input(output) == MATRIX_UNKNOWN) {
+        m_model.route(output, input);
+    }
+}
+void SerialPass::cycle(uint8_t output, uint8_t inputs) {
+    if (output < 1 || output > MATRIX_OUTPUTS) {
+        return;
+    }
+    uint8_t current = m_targets[output - 1];
+    if (current == MATRIX_UNKNOWN) {
+        current = m_model.input(output);
+    }
+    request(output, (current >= inputs) ? 1 : (current + 1));
+}
+/**
+ * Each frame is queued whole, between host frames, so the receive interrupt
+ * cannot interleave with it. The model takes the new route as it is sent.
+ */
+void SerialPass::dispatch() {
+    uint16_t now = static_cast<uint16_t>(millis());
+    if (m_requests != m_requests_seen) {
+        m_requests_seen = m_requests;
+        m_request_time = now;
+    }
+    if (static_cast<uint16_t>(now - m_request_time) < MATRIX_SETTLE_MS) {
+        return;
+    }
+    for (uint8_t output = 1; output <= MATRIX_OUTPUTS; output++) {
+        noInterrupts();
+        uint8_t input = m_targets[output - 1];
+        if (input == MATRIX_UNKNOWN) {
+            //Nothing requested
+        } else if (input == m_model.input(output)) {
+            m_targets[output - 1] = MATRIX_UNKNOWN;
+            m_skipped++;
+        } else if (m_state == IDLE &&
+                   m_out.availableForWrite() >= static_cast<int>(sizeof(m_matrix))) {
+            digits(m_matrix + MATRIX_HEADER_SIZE, input);
+            digits(m_matrix + MATRIX_HEADER_SIZE + 2, output);
+            for (unsigned int i = 0; i < sizeof(m_matrix); i++) {
+                m_out.push(static_cast<uint8_t>(m_matrix[i]));
+                m_activity[SERIAL_MATRIX] = m_activity[SERIAL_MATRIX] + 1;
+            }
+            m_model.route(output, input);
+            m_targets[output - 1] = MATRIX_UNKNOWN;
+            m_switched++;
+        }
+        interrupts();
+    }
 }
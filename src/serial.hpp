@@ -2,43 +2,219 @@
  * serial.hpp:
  *
  * This sets up the Serial pass-through and deframes any system-based messages
- * to interpret them locally.
+ * to interpret them locally. Messages whose key starts with QUERY_CMD are
+ * queries of the switch itself, and are answered back to the host.
+ *
+ * Host bytes are deframed as they arrive, in the host receive interrupt, and
+ * passthrough bytes go straight on to the matrix transmit buffer. Only control
+ * frames wait for the main loop. Bytes the interrupt cannot take (while a
+ * control frame is pending, or the matrix buffer is full) are buffered by the
+ * host port, and deframed by run in order. The grammar of the host stream is
+ * kept as tables (deframer.hpp), deframing each byte in constant time, with
+ * hooks opening, capturing, forwarding, counting, and emitting frames.
+ *
+ * Matrix frames are pipelined: host frames keep flowing while reads await
+ * their response. Each read's command code is queued. Matrix bytes are passed
+ * back to the host from the matrix receive interrupt in the same way, parsing
+ * the reply framing ("MT00" code data "NT") to match each reply to the oldest
+ * read. Once MATRIX_PENDING reads are in flight, the end of the next
+ * read is held back until a reply frees a slot.
+ *
+ * Reads can also be answered by the switch itself, from a model of the matrix
+ * routing state (MatrixState). The model follows the switch commands passed
+ * on to the matrix, the switch's own included, and the read replies passed back. While
+ * a read reply has been seen within the cache age, and the model is complete,
+ * host reads are not sent on. They take their turn in the read queue, and are
+ * answered from the model when they reach its head, so replies keep the order
+ * of their reads. To tell reads apart, the deframer holds each frame's header
+ * back until its command code. An optional background refresh reads the
+ * matrix itself while the link is idle, keeping the model fresh.
+ *
+ * The switch routes outputs itself on request, as from the podium button.
+ * Requests only record the input wanted for each output, the last one winning.
+ * Once requests have settled, run sends one switch command per output whose
+ * wanted input differs from the model, so a burst of presses makes a single
+ * transaction, and a press back to the current input makes none.
+ *
+ * Neither side can wedge the passthrough. The oldest read is given up on once
+ * its reply shows no progress for the timeout, freeing its slot. Host frames
+ * and replies that run past their longest valid length, and replies cut short
+ * by the start of another, are dropped by their parser, which resyncs on the
+ * next frame start. Timeouts and resyncs are counted for <?SER>.
+ *
+ * Control messages may also come as binary frames, many to a frame, checked
+ * and acknowledged:
+ *
+ *   BINARY_START, length, sequence, payload (length bytes), CRC-16 (2 bytes)
+ *
+ * The CRC is CRC-16/CCITT-FALSE over the length, sequence, and payload, sent
+ * high byte first. The payload is a run of records, each a header byte, a
+ * MAX_KEY_LEN byte key, zero padded, then a value. The header's top two bits
+ * are the operation, and its low six bits the value's length:
+ *
+ *   BINARY_OP_TEXT     text message, up to MAX_STR_LEN bytes
+ *   BINARY_OP_ADDRESS  IPv4 address, its 4 bytes
+ *   BINARY_OP_NUMBER   signed integer, 1 to 4 bytes little endian
+ *   BINARY_OP_QUERY    query of the switch, no value
+ *
+ * A frame's records are applied all together, or not at all. Each frame is
+ * answered with a binary frame of the same sequence number, its payload the
+ * status and the count of records applied. A frame repeating both the
+ * sequence number and the CRC of the last frame applied is taken to be a
+ * resend, after a lost acknowledgement. It is acknowledged again, but not
+ * applied twice. Frames failing the CRC are acknowledged with BINARY_ACK_CRC
+ * for the host to send again, and counted for <?SER>. A frame going quiet for
+ * BINARY_GAP_MS between bytes, from a stray start or a lost byte, is dropped
+ * and counted as a resync, so the frames after it are not swallowed.
+ *
+ * Each host byte passed on to the matrix is reported to Boot::forwarded, from
+ * wherever it was passed on, the receive interrupts included, for the time of
+ * the first. Bytes passed on to either port are only counted there; run calls
+ * the activity handler once a batch, from the main loop.
  *
  *  Created on: Nov 11, 2018
  *      Author: lestarch
  */
 #ifndef SRC_SERIAL_HPP_
 #define SRC_SERIAL_HPP_
-#include <Arduino.h>
-#include <SoftwareSerial.h>
+#include "hal.hpp"
 #include "types.hpp"
-#define START_CMD '<'
-#define END_CMD '>'
-#define MAX_MATRIX 2
-#define RESPONSE_SIZE 48
+#include "matrix.hpp"
+#include "deframer.hpp"
+//!< First key character marking a query of the switch
+#define QUERY_CMD '?'
+//!< Query key printing runner telemetry
+#define QUERY_TIMING "?TIM"
+//!< Query key clearing runner telemetry
+#define QUERY_TIMING_RESET "?TRS"
+//!< Free host transmit space needed before printing a report line
+#define REPORT_TX_SPACE 63
+//!< Query key printing passthrough counters
+#define QUERY_SERIAL "?SER"
+//!< Query key printing button counters
+#define QUERY_BUTTON "?BTN"
+//!< Query key printing boot stage timings
+#define QUERY_BOOT "?BOT"
+//!< No report being printed
+#define REPORT_NONE 0xFF
+//!< Report printing passthrough counters
+#define REPORT_SERIAL 0xFE
+//!< Report printing button counters
+#define REPORT_BUTTON 0xFD
+//!< Report printing boot stage timings
+#define REPORT_BOOT 0xFC
+//!< Matrix reads in flight at once, must be a power of two
+#define MATRIX_PENDING 4
+//!< Offset of the two character command code in a matrix frame
+#define MATRIX_CODE_OFFSET 4
+//!< Frame start and command code, held back to decide where a frame goes
+#define MATRIX_HEADER_SIZE (MATRIX_CODE_OFFSET + 2)
+//!< Switch command parameters: two digit input, then two digit output
+#define MATRIX_PARAM_SIZE 4
+//!< First code character of commands the matrix answers
+#define MATRIX_READ_CMD 'R'
+//!< First code character of switch commands
+#define MATRIX_SWITCH_CMD 'S'
+//!< Default longest time since a read reply that reads are answered locally
+#define MATRIX_CACHE_MS 2000
+//!< Default background refresh period, 0 for none
+#define MATRIX_REFRESH_MS 0
+//!< Default time a read's reply may show no progress before it is given up on
+#define MATRIX_TIMEOUT_MS 200
+//!< Longest host matrix frame before the deframer resyncs
+#define MATRIX_FRAME_MAX 32
+//!< Longest matrix reply before the reply parser resyncs
+#define MATRIX_REPLY_MAX 64
+//!< Quiet time after a routing request before it is sent, coalescing bursts
+#define MATRIX_SETTLE_MS 100
+//!< Longest binary frame payload
+#define BINARY_PAYLOAD_MAX 96
+//!< Longest gap between the bytes of a binary frame before it is dropped
+#define BINARY_GAP_MS 50
+//!< Binary frame bytes around the payload: start, length, sequence, and CRC
+#define BINARY_OVERHEAD 5
+//!< CRC-16/CCITT-FALSE polynomial and initial value
+#define BINARY_CRC_POLY 0x1021
+#define BINARY_CRC_INIT 0xFFFF
+//!< Binary record operations, in the top two bits of a record header
+#define BINARY_OP_TEXT 0
+#define BINARY_OP_ADDRESS 1
+#define BINARY_OP_NUMBER 2
+#define BINARY_OP_QUERY 3
+//!< Shift of the operation in a record header, and mask of the value length
+#define BINARY_OP_SHIFT 6
+#define BINARY_LENGTH_MASK 0x3F
+//!< Acknowledgement payload size: status, and records applied
+#define BINARY_ACK_SIZE 2
+//!< Acknowledgement statuses: applied, failed the CRC, records malformed
+#define BINARY_ACK_OK 0
+#define BINARY_ACK_CRC 1
+#define BINARY_ACK_MALFORMED 2
+//!< Command data: a text frame's key and message, or a binary payload
+#define COMMAND_SIZE ((BINARY_PAYLOAD_MAX > (MAX_KEY_LEN + MAX_STR_LEN + 1)) ? \
+                      BINARY_PAYLOAD_MAX : (MAX_KEY_LEN + MAX_STR_LEN + 1))
 #define MATRIX_TEMPLATE_SIZE 12
 //Template to fill with characters
-#define MATRIX_TEMPLATE_STR "MT00SW0x02NT"
+#define MATRIX_TEMPLATE_STR "MT00SW0000NT"
 
-enum SerialState {
-    IDLE,    // Nothing going on
-    COMMAND, // Processing a command
-    MSG1,    // First part of message (before first T)
-    MSG2,    // Second part of message (before closing T)
-    RESP,    // Response
+//!< External handler for serial activity
+typedef void (*SerialHandle)(SerialType serial);
+/**
+ * BinaryAck:
+ *
+ * Acknowledgement of a binary frame.
+ */
+struct BinaryAck {
+    uint8_t sequence; //!< Sequence number of the frame
+    uint8_t status;   //!< BINARY_ACK status
+    uint8_t count;    //!< Records applied
+};
+/**
+ * Fold a byte into a CRC-16/CCITT-FALSE.
+ * \param uint16_t crc: CRC so far, BINARY_CRC_INIT to start
+ * \param uint8_t byte: byte to fold in
+ * \return CRC with the byte
+ */
+uint16_t crc16(uint16_t crc, uint8_t byte);
+/**
+ * PendingKind:
+ *
+ * Who answers a pending read, and who gets the answer.
+ */
+enum PendingKind {
+    PENDING_MATRIX,  //!< Host read, answered by the matrix
+    PENDING_LOCAL,   //!< Host read, answered from the model
+    PENDING_REFRESH, //!< Background refresh, answered by the matrix to the model
 };
 
 class SerialPass {
     public:
         /**
          * Serial constructor taking in and out types.
+         * \param HostSerial& in: host port
+         * \param MatrixSerial& out: matrix port
+         * \param uint16_t timeout: time a reply may show no progress, in ms
+         */
+        SerialPass(HostSerial& in, MatrixSerial& out, uint16_t timeout = MATRIX_TIMEOUT_MS);
+        /**
+         * Configure answering reads from the model.
+         * \param uint16_t age: longest time since a read reply to answer reads
+         *        locally in ms, 0 to always read the matrix
+         * \param uint16_t refresh: background refresh period in ms, 0 for none
+         */
+        void cache(uint16_t age, uint16_t refresh);
+        /**
+         * Register a handler for serial activity. It is called from run, at
+         * most once a port each pass of its loop that passed bytes on to the
+         * port, never in interrupt context.
+         * \param SerialHandle handler: handler function to call on activity
          */
-        SerialPass(HardwareSerial& in, SoftwareSerial& out);
+        void register_handler(SerialHandle handler);
         /**
          * Begin the serial port
-         * \param int baud: baud rate
+         * \param unsigned long baud: baud rate
          */
-        void begin(int baud);
+        void begin(unsigned long baud);
         /**
          * Runs the serial passthough and deframer for the specified number of
          * milli-seconds. Once the time expires, control will return to the
@@ -46,30 +222,235 @@ class SerialPass {
          * \param uint32_t wait: number of milliseconds to run for
          */
         void run(uint32_t wait);
-        /** 
-	 * Interrupt line
-	 */
-	void interrupt();
         /**
-         * Iterate through the available device.
+         * Request an output be routed from an input, replacing any request
+         * for the output not yet sent. Safe in interrupt context.
+         * \param uint8_t output: output, from 1
+         * \param uint8_t input: input, from 1
+         */
+        void request(uint8_t output, uint8_t input);
+        /**
+         * Request an output be routed from the next of the first inputs, after
+         * the one requested, or else the one routed. Safe in interrupt context.
+         * \param uint8_t output: output, from 1
+         * \param uint8_t inputs: inputs to cycle through
+         */
+        void cycle(uint8_t output, uint8_t inputs);
+        /**
+         * Input an output is routed from, or is to be once its request is
+         * sent.
+         * \param uint8_t output: output, from 1
+         * \return input, or MATRIX_UNKNOWN
+         */
+        uint8_t target(uint8_t output) const;
+        /**
+         * Restore a route known from before a reset into the model, such that
+         * routing requests carry on from it.
+         * \param uint8_t output: output, from 1
+         * \param uint8_t input: input routed to it, from 1
+         */
+        void restore(uint8_t output, uint8_t input);
+        /**
+         * Deframe one host byte. Called from the host receive interrupt, or
+         * with interrupts off.
+         * \param uint8_t byte: host byte
+         * \return true if taken, false to leave it buffered for later
+         */
+        bool deframe(uint8_t byte);
+        /**
+         * Forward one matrix byte to the host, parsing reply framing. Called
+         * from the matrix receive interrupt, or with interrupts off.
+         * \param uint8_t byte: matrix byte
+         * \return true if taken, false to leave it buffered for later
          */
-        void toggle();
+        bool forward(uint8_t byte);
+        //!< Instance deframing in the receive interrupt
+        static SerialPass* s_instance;
     private:
+        //!< Bench deframer, driving the deframer hooks and state by a chain of
+        //!< comparisons
+        friend class ChainDeframer;
+        /**
+         * Answer a query from the host.
+         * \param const uint8_t* key: query key, MAX_KEY_LEN long
+         */
+        void query(const uint8_t* key);
+        /**
+         * Deframer hook opening a matrix frame.
+         */
+        void open();
+        /**
+         * Deframer hook capturing a text control frame byte, up to the
+         * longest key and message.
+         * \param uint8_t byte: host byte
+         */
+        void capture(uint8_t byte);
+        /**
+         * Deframer hook forwarding a matrix frame byte, moving to the next
+         * state once taken, or to IDLE if the frame overruns.
+         * \param uint8_t byte: host byte
+         * \param SerialState next: state after the byte
+         * \return true if taken, false to leave it buffered for later
+         */
+        bool relay(uint8_t byte, SerialState next);
+        /**
+         * Deframer hook taking a binary frame byte, moving to IDLE once the
+         * frame is complete, or its length is too long.
+         * \param uint8_t byte: host byte
+         */
+        void take(uint8_t byte);
+        /**
+         * Check a complete binary frame, apply its records, and queue its
+         * acknowledgement.
+         */
+        void binary();
+        /**
+         * Send the queued acknowledgement to the host.
+         */
+        void acknowledge();
+        /**
+         * Parse a matrix byte for reply framing, matching each complete reply
+         * to the oldest pending read.
+         * \param uint8_t byte: byte from the matrix
+         */
+        void reply(uint8_t byte);
+        /**
+         * Give up on the oldest read once its reply has shown no progress for
+         * the timeout.
+         */
+        void expire();
+        /**
+         * Print the passthrough counters as a report line.
+         */
+        void report();
+        /**
+         * Send settled routing requests the model does not already meet.
+         */
+        void dispatch();
+        /**
+         * Send the held back frame header on to the matrix, all or nothing.
+         * \param uint8_t count: header bytes held
+         * \return true if sent, false when there was not room
+         */
+        bool flush(uint8_t count);
+        /**
+         * Age the model, answer reads at the head of the queue from it, and
+         * send background refreshes.
+         */
+        void freshen();
+        /**
+         * Queue a pending read. There must be a free slot.
+         * \param const char* code: two character command code
+         * \param PendingKind kind: who answers it
+         */
+        void await(const char* code, PendingKind kind);
+        /**
+         * Kind of the oldest pending read.
+         * \return kind, or PENDING_MATRIX if there are none
+         */
+        PendingKind head() const;
         //!< Hardware serial input (from host)
-        HardwareSerial& m_in;
+        HostSerial& m_in;
         //!< Hardware serial output to Matrix
-        SoftwareSerial& m_out;
+        MatrixSerial& m_out;
         //!< Index into m_cmd
         unsigned int m_cmd_index;
-        //!< Index into response count
-        unsigned int m_response_count;
         //!< Serial state to process commands, or others
-        SerialState m_state;
-        //!< Command data
-        uint8_t m_cmd[MAX_KEY_LEN + MAX_STR_LEN];
+        volatile SerialState m_state;
+        //!< Command data is complete, waiting for the main loop, and is a
+        //!< binary frame
+        volatile bool m_command;
+        volatile bool m_binary;
+        //!< A report line is being printed to the host
+        volatile bool m_reporting;
+        //!< Index into the current matrix frame, its held back header, and
+        //!< its switch parameters
+        uint8_t m_frame_index;
+        char m_header[MATRIX_HEADER_SIZE];
+        char m_param[MATRIX_PARAM_SIZE];
+        //!< Current host frame is a read answered locally, not sent on
+        bool m_divert;
+        //!< Codes and kinds of reads awaiting replies, written by deframe, read
+        //!< by run. Head and tail count freely, and are masked to index.
+        char m_pending[MATRIX_PENDING][2];
+        uint8_t m_pending_kind[MATRIX_PENDING];
+        volatile uint8_t m_pending_head;
+        volatile uint8_t m_pending_tail;
+        //!< Index into the current reply, its command code, and last byte
+        uint8_t m_reply_index;
+        char m_reply_code[2];
+        char m_reply_last;
+        //!< Reply route being parsed: field value, and its output
+        uint8_t m_reply_value;
+        uint8_t m_reply_output;
+        //!< Model of the matrix routing state
+        MatrixState m_model;
+        //!< Reads may be answered from the model
+        volatile bool m_fresh;
+        //!< Bumped by the interrupt on each complete read reply
+        volatile uint8_t m_syncs;
+        //!< Last reply count seen by run, when, and whether within the age
+        uint8_t m_syncs_seen;
+        uint16_t m_synced_time;
+        bool m_synced;
+        //!< Cache age and background refresh period in ms, and last refresh
+        uint16_t m_cache_age;
+        uint16_t m_refresh;
+        uint16_t m_refresh_time;
+        //!< Reads answered from the model
+        uint16_t m_local;
+        //!< Input requested for each output, or MATRIX_UNKNOWN for none
+        volatile uint8_t m_targets[MATRIX_OUTPUTS];
+        //!< Bumped on each request, last seen by run, and when, to settle
+        volatile uint8_t m_requests;
+        uint8_t m_requests_seen;
+        uint16_t m_request_time;
+        //!< Requests sent, and requests the model already met
+        uint16_t m_switched;
+        uint16_t m_skipped;
+        //!< Replies matched to a read
+        uint16_t m_matched;
+        //!< Replies with no read to match
+        uint16_t m_unexpected;
+        //!< Reads given up on, and frames dropped by a parser
+        uint16_t m_timeouts;
+        uint16_t m_resyncs;
+        //!< Bumped by the interrupts as the oldest read's reply progresses
+        volatile uint8_t m_progress;
+        //!< Last progress seen by run, and when, for the timeout
+        uint8_t m_progress_seen;
+        uint16_t m_progress_time;
+        //!< Time a reply may show no progress in ms
+        uint16_t m_timeout;
+        //!< Command data, and its terminator
+        uint8_t m_cmd[COMMAND_SIZE];
+        //!< Binary frame payload length, sequence number, and CRC
+        uint8_t m_binary_length;
+        uint8_t m_binary_sequence;
+        uint16_t m_binary_crc;
+        //!< Bumped by the interrupts as a binary frame progresses, last seen
+        //!< by run, and when, for the gap
+        volatile uint8_t m_binary_progress;
+        uint8_t m_binary_seen;
+        uint16_t m_binary_time;
+        //!< Acknowledgement to send, and whether one is queued
+        BinaryAck m_ack;
+        bool m_acking;
+        //!< Acknowledgement and CRC of the last frame applied, if any
+        BinaryAck m_applied;
+        uint16_t m_applied_crc;
+        bool m_applied_valid;
+        //!< Binary frames failing the CRC
+        uint16_t m_crc_errors;
+        //!< Bumped as bytes are passed on to each port, the interrupts
+        //!< included, and last seen by run, for the activity handler
+        volatile uint8_t m_activity[MAX_SERIAL];
+        uint8_t m_activity_seen[MAX_SERIAL];
+        //!< Serial activity handler
+        SerialHandle m_handler;
         //!< Non-constant storage
         char m_matrix[MATRIX_TEMPLATE_SIZE];
-        //!< Interrupted
-        bool m_interrupt;
+        //!< Next telemetry report to print, or REPORT_NONE
+        uint8_t m_report;
 };
 #endif /* SRC_SERIAL_HPP_ */
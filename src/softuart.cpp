@@ -0,0 +1,180 @@
+/*
+ * softuart.cpp:
+ *
+ * Interrupt-driven software UART implementations. Board only.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifdef ARDUINO
+#include "softuart.hpp"
+//!< Ring buffer index mask
+#define SOFT_UART_MASK (SOFT_UART_BUFFER - 1)
+//!< Bits in a frame: start, eight data, and stop
+#define SOFT_UART_FRAME_BITS 10
+
+//Concrete definitions of the interrupt shared state
+volatile uint8_t SoftUart::s_overflow = 0;
+volatile uint8_t* SoftUart::s_tx_port = NULL;
+uint8_t SoftUart::s_tx_mask = 0;
+volatile uint8_t* SoftUart::s_rx_port = NULL;
+uint8_t SoftUart::s_rx_mask = 0;
+uint8_t SoftUart::s_tx_buffer[SOFT_UART_BUFFER];
+volatile uint8_t SoftUart::s_tx_head = 0;
+volatile uint8_t SoftUart::s_tx_tail = 0;
+uint16_t SoftUart::s_tx_shift = 0;
+uint8_t SoftUart::s_tx_bits = 0;
+uint8_t SoftUart::s_tx_ticks = SOFT_UART_OVERSAMPLE;
+uint8_t SoftUart::s_rx_buffer[SOFT_UART_BUFFER];
+volatile uint8_t SoftUart::s_rx_head = 0;
+volatile uint8_t SoftUart::s_rx_tail = 0;
+SerialReceiver SoftUart::s_receiver = NULL;
+uint8_t SoftUart::s_rx_shift = 0;
+uint8_t SoftUart::s_rx_bits = 0;
+volatile uint8_t SoftUart::s_rx_ticks = 0;
+
+/**
+ * Timer1 overflows at the oversampled bit rate
+ */
+ISR(TIMER1_OVF_vect) {
+    SoftUart::tick();
+}
+/**
+ * Only stores pins, hardware is set up in begin
+ */
+SoftUart::SoftUart(uint8_t rx, uint8_t tx) :
+    m_rx(rx),
+    m_tx(tx)
+{}
+/**
+ * Take over Timer1 at the oversampled bit rate, keeping any PWM outputs
+ * enabled on it, and arm the start bit interrupt.
+ */
+void SoftUart::begin(unsigned long baud) {
+    baud = (baud > SOFT_UART_MAX_BAUD) ? SOFT_UART_MAX_BAUD : baud;
+    pinMode(m_tx, OUTPUT);
+    digitalWrite(m_tx, HIGH);
+    pinMode(m_rx, INPUT_PULLUP);
+    s_tx_port = portOutputRegister(digitalPinToPort(m_tx));
+    s_tx_mask = digitalPinToBitMask(m_tx);
+    s_rx_port = portInputRegister(digitalPinToPort(m_rx));
+    s_rx_mask = digitalPinToBitMask(m_rx);
+    uint8_t sreg = SREG;
+    cli();
+    //Fast PWM, TOP = ICR1 (mode 14)
+    TCCR1A = (TCCR1A & (_BV(COM1A1) | _BV(COM1A0) | _BV(COM1B1) | _BV(COM1B0))) | _BV(WGM11);
+    TCCR1B = _BV(WGM13) | _BV(WGM12) | _BV(CS11);
+    ICR1 = ((F_CPU / SOFT_UART_PRESCALE / SOFT_UART_OVERSAMPLE) + (baud / 2)) / baud - 1;
+    TCNT1 = 0;
+    TIMSK1 |= _BV(TOIE1);
+    SREG = sreg;
+    attachInterrupt(digitalPinToInterrupt(m_rx), SoftUart::start_bit, FALLING);
+}
+void SoftUart::set_receiver(SerialReceiver receiver) {
+    uint8_t sreg = SREG;
+    cli();
+    s_receiver = receiver;
+    SREG = sreg;
+}
+int SoftUart::available() {
+    return (s_rx_head - s_rx_tail) & SOFT_UART_MASK;
+}
+int SoftUart::availableForWrite() {
+    return SOFT_UART_MASK - ((s_tx_head - s_tx_tail) & SOFT_UART_MASK);
+}
+int SoftUart::read() {
+    if (s_rx_head == s_rx_tail) {
+        return -1;
+    }
+    uint8_t byte = s_rx_buffer[s_rx_tail];
+    s_rx_tail = (s_rx_tail + 1) & SOFT_UART_MASK;
+    return byte;
+}
+int SoftUart::peek() {
+    return (s_rx_head == s_rx_tail) ? -1 : s_rx_buffer[s_rx_tail];
+}
+/**
+ * Queue the byte. A full buffer drains at the baud rate, so waiting here is
+ * bounded by one byte-time. Interrupts are held off around each attempt, as
+ * interrupt handlers may push too.
+ */
+size_t SoftUart::write(uint8_t byte) {
+    bool queued = false;
+    while (!queued) {
+        uint8_t sreg = SREG;
+        cli();
+        queued = push(byte);
+        SREG = sreg;
+    }
+    return 1;
+}
+bool SoftUart::push(uint8_t byte) {
+    uint8_t next = (s_tx_head + 1) & SOFT_UART_MASK;
+    if (next == s_tx_tail) {
+        return false;
+    }
+    s_tx_buffer[s_tx_head] = byte;
+    s_tx_head = next;
+    return true;
+}
+/**
+ * Transmit shifts a bit every SOFT_UART_OVERSAMPLE ticks. Receive counts down
+ * to each sample, and re-arms the start bit interrupt after the stop bit.
+ */
+void SoftUart::tick() {
+    s_tx_ticks--;
+    if (s_tx_ticks == 0) {
+        s_tx_ticks = SOFT_UART_OVERSAMPLE;
+        //Load the next frame: start bit low, data LSB first, stop bit high
+        if (s_tx_bits == 0 && s_tx_head != s_tx_tail) {
+            s_tx_shift = (static_cast<uint16_t>(s_tx_buffer[s_tx_tail]) << 1) | 0x200;
+            s_tx_tail = (s_tx_tail + 1) & SOFT_UART_MASK;
+            s_tx_bits = SOFT_UART_FRAME_BITS;
+        }
+        if (s_tx_bits != 0) {
+            if (s_tx_shift & 0x1) {
+                *s_tx_port |= s_tx_mask;
+            } else {
+                *s_tx_port &= ~s_tx_mask;
+            }
+            s_tx_shift = s_tx_shift >> 1;
+            s_tx_bits--;
+        }
+    }
+    if (s_rx_ticks == 0 || --s_rx_ticks != 0) {
+        return;
+    }
+    bool high = (*s_rx_port & s_rx_mask) != 0;
+    if (s_rx_bits < 8) {
+        s_rx_shift = (s_rx_shift >> 1) | (high ? 0x80 : 0x00);
+        s_rx_bits++;
+        s_rx_ticks = SOFT_UART_OVERSAMPLE;
+        return;
+    }
+    //Stop bit, a low stop bit is a framing error and the byte is dropped. The
+    //receiver is offered the byte only when nothing is buffered ahead of it.
+    if (high && !(s_rx_head == s_rx_tail && s_receiver != NULL && s_receiver(s_rx_shift))) {
+        uint8_t next = (s_rx_head + 1) & SOFT_UART_MASK;
+        if (next != s_rx_tail) {
+            s_rx_buffer[s_rx_head] = s_rx_shift;
+            s_rx_head = next;
+        } else {
+            s_overflow++;
+        }
+    }
+    //Data bits set the edge flag, clear it before re-arming
+    EIFR = _BV(INTF1);
+    EIMSK |= _BV(INT1);
+}
+/**
+ * Mask further edges until the byte is in, and count down to the middle of
+ * the first data bit: one and a half bits past the edge. The edge falls
+ * somewhere within a tick, so this samples within half a tick of the middle.
+ */
+void SoftUart::start_bit() {
+    EIMSK &= ~_BV(INT1);
+    s_rx_bits = 0;
+    s_rx_shift = 0;
+    s_rx_ticks = (SOFT_UART_OVERSAMPLE * 3) / 2 + 1;
+}
+#endif
@@ -0,0 +1,128 @@
+/*
+ * softuart.hpp:
+ *
+ * Interrupt-driven software UART for the matrix link. This replaces
+ * SoftwareSerial, which holds interrupts off for every bit it sends. Here both
+ * directions run from interrupts, in the background, through ring buffers:
+ *
+ * 1. Timer1 is run in fast PWM mode with ICR1 as TOP, overflowing at three
+ *    times the bit rate. Each overflow shifts out one third of a transmit bit
+ *    and counts down to the next receive sample.
+ * 2. The falling edge of a start bit on the receive pin (INT1, pin 3) starts a
+ *    reception, sampling each bit at the overflow nearest its middle. As on
+ *    HostUart, a receiver may take each byte in the interrupt.
+ *
+ * Writes queue bytes and return at once, unless the transmit buffer is full.
+ * Timer1 also drives PWM on pins 9 and 10, which keeps working at the new TOP:
+ * Pin<PIN>::pwm scales duty to it. Only one instance may exist.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_SOFTUART_HPP_
+#define SRC_SOFTUART_HPP_
+#include <Arduino.h>
+#include "types.hpp"
+//!< Ring buffer sizes, must be a power of two
+#define SOFT_UART_BUFFER 64
+//!< Timer ticks per bit
+#define SOFT_UART_OVERSAMPLE 3
+//!< Timer1 prescaler
+#define SOFT_UART_PRESCALE 8
+//!< Highest supported baud, limited by the timer interrupt rate
+#define SOFT_UART_MAX_BAUD 19200
+
+class SoftUart : public Print {
+    public:
+        /**
+         * Construct the UART on its pins. The receive pin must be pin 3, as
+         * it needs the INT1 external interrupt.
+         * \param uint8_t rx: receive pin
+         * \param uint8_t tx: transmit pin
+         */
+        SoftUart(uint8_t rx, uint8_t tx);
+        /**
+         * Set up pins, Timer1, and the start bit interrupt.
+         * \param unsigned long baud: baud rate, up to SOFT_UART_MAX_BAUD
+         */
+        void begin(unsigned long baud);
+        /**
+         * Register the receiver offered each byte from the timer interrupt.
+         * It runs in interrupt context, and must be fast.
+         * \param SerialReceiver receiver: receiver, or NULL to buffer all bytes
+         */
+        void set_receiver(SerialReceiver receiver);
+        /**
+         * Bytes waiting in the receive buffer.
+         */
+        int available();
+        /**
+         * Space left in the transmit buffer.
+         */
+        int availableForWrite();
+        /**
+         * Read a received byte.
+         * \return byte, or -1 if none
+         */
+        int read();
+        /**
+         * Look at the next received byte, without taking it.
+         * \return byte, or -1 if none
+         */
+        int peek();
+        /**
+         * Queue a byte to send. Waits for space only when the transmit buffer
+         * is full. Must not be called from interrupt context, use push.
+         * \param uint8_t byte: byte to send
+         * \return 1
+         */
+        size_t write(uint8_t byte);
+        using Print::write;
+        /**
+         * Queue a byte to send without waiting. Safe in interrupt context, or
+         * with interrupts off.
+         * \param uint8_t byte: byte to send
+         * \return true if queued, false when the transmit buffer is full
+         */
+        bool push(uint8_t byte);
+        /**
+         * Timer1 overflow handler: shifts transmit bits and samples receive
+         * bits. Called from the timer interrupt.
+         */
+        static void tick();
+        /**
+         * Start bit handler. Called from the INT1 interrupt.
+         */
+        static void start_bit();
+        //!< Bytes lost on a full receive buffer
+        static volatile uint8_t s_overflow;
+    private:
+        //!< Receive and transmit pins
+        uint8_t m_rx;
+        uint8_t m_tx;
+        //!< Transmit pin output register and mask
+        static volatile uint8_t* s_tx_port;
+        static uint8_t s_tx_mask;
+        //!< Receive pin input register and mask
+        static volatile uint8_t* s_rx_port;
+        static uint8_t s_rx_mask;
+        //!< Transmit ring buffer, written by write, read by tick
+        static uint8_t s_tx_buffer[SOFT_UART_BUFFER];
+        static volatile uint8_t s_tx_head;
+        static volatile uint8_t s_tx_tail;
+        //!< Transmit shift register, bits left in it, and ticks to next bit
+        static uint16_t s_tx_shift;
+        static uint8_t s_tx_bits;
+        static uint8_t s_tx_ticks;
+        //!< Receive ring buffer, written by tick, read by read
+        static uint8_t s_rx_buffer[SOFT_UART_BUFFER];
+        static volatile uint8_t s_rx_head;
+        static volatile uint8_t s_rx_tail;
+        //!< Receiver taking bytes in the interrupt
+        static SerialReceiver s_receiver;
+        //!< Receive shift register, bits taken, and ticks to next sample
+        static uint8_t s_rx_shift;
+        static uint8_t s_rx_bits;
+        static volatile uint8_t s_rx_ticks;
+};
+#endif /* SRC_SOFTUART_HPP_ */
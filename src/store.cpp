@@ -0,0 +1,261 @@
+/*
+ * store.cpp:
+ *
+ * Message store implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <string.h>
+#include "store.hpp"
+#include "version.hpp"
+//!< Most digits of an integer stored as a number, so it always fits
+#define STORE_NUMBER_DIGITS 9
+static_assert(STORE_ENTRIES < STORE_INDEX, "Hash index needs an empty slot");
+static_assert((STORE_INDEX & (STORE_INDEX - 1)) == 0, "Hash index must be a power of two");
+static_assert(sizeof(STORE_FIRMWARE_KEY) <= MAX_KEY_LEN + 1, "Firmware key too long");
+static_assert(STORE_ARENA >= MAX_STR_LEN && STORE_ARENA <= 0xFF, "Arena must fit a message, and uint8_t offsets");
+
+/**
+ * Read a decimal field of at most count digits, up to the end. Leading zeros
+ * are refused, such that the field prints back as it was read.
+ */
+static bool decimal(const char*& text, const char* end, uint8_t count, uint32_t& value) {
+    value = 0;
+    uint8_t digits = 0;
+    while (text < end && *text >= '0' && *text <= '9') {
+        if (digits == count || (digits == 1 && value == 0)) {
+            return false;
+        }
+        value = value * 10 + (*text - '0');
+        digits++;
+        text++;
+    }
+    return digits > 0;
+}
+/**
+ * Print an unsigned value in decimal, returning the end of the digits
+ */
+static char* digits(char* text, uint32_t value) {
+    char reversed[10];
+    uint8_t count = 0;
+    do {
+        reversed[count++] = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (count > 0) {
+        *text++ = reversed[--count];
+    }
+    return text;
+}
+/**
+ * Type a message by what prints back exactly as sent: four dotted octets, or
+ * a signed integer. Anything else is a string.
+ */
+static StoreType parse(const char* msg, uint8_t length, StoreValue& parsed) {
+    const char* end = msg + length;
+    const char* text = msg;
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < 4; i++) {
+        if (!decimal(text, end, 3, value) || value > 0xFF) {
+            break;
+        }
+        parsed.address[i] = static_cast<uint8_t>(value);
+        if (i == 3 && text == end) {
+            return STORE_ADDRESS;
+        }
+        if (text == end || *text != '.') {
+            break;
+        }
+        text++;
+    }
+    text = msg;
+    bool negative = (text < end && *text == '-');
+    text += negative ? 1 : 0;
+    if (decimal(text, end, STORE_NUMBER_DIGITS, value) && text == end && !(negative && value == 0)) {
+        parsed.number = negative ? -static_cast<int32_t>(value) : static_cast<int32_t>(value);
+        return STORE_NUMBER;
+    }
+    return STORE_STRING;
+}
+
+MessageStore::MessageStore() :
+    m_count(0),
+    m_used(0),
+    m_stamp(0)
+{
+    memset(m_index, STORE_NONE, sizeof(m_index));
+}
+uint32_t MessageStore::pack(const char* key) {
+    uint32_t packed = 0;
+    for (uint8_t i = 0; i < MAX_KEY_LEN && key[i] != '\0'; i++) {
+        packed |= static_cast<uint32_t>(static_cast<uint8_t>(key[i])) << (8 * i);
+    }
+    return packed;
+}
+void MessageStore::set(const char* key, const char* msg) {
+    set(key, msg, strnlen(msg, MAX_STR_LEN));
+}
+void MessageStore::set(const char* key, const char* msg, uint8_t length) {
+    StoreValue parsed;
+    length = (length < MAX_STR_LEN) ? length : MAX_STR_LEN;
+    StoreType type = parse(msg, length, parsed);
+    update(pack(key), type, parsed, msg, length);
+}
+void MessageStore::set(const char* key, StoreType type, const StoreValue& value) {
+    update(pack(key), type, value, NULL, 0);
+}
+/**
+ * Stamps order updates, for pushing out the least recently updated. A
+ * typed value is written over the entry. A string is copied over its last
+ * one when the lengths match, and otherwise moved to the end of the arena.
+ */
+void MessageStore::update(uint32_t key, StoreType type, const StoreValue& value,
+                          const char* msg, uint8_t length) {
+    uint8_t entry = find(key);
+    if (entry == STORE_NONE) {
+        if (m_count == STORE_ENTRIES) {
+            remove(oldest(STORE_NONE, false), STORE_NONE);
+        }
+        entry = m_count;
+        m_count++;
+        m_entries[entry].key = key;
+        m_entries[entry].type = STORE_NUMBER;
+        m_index[slot(key)] = entry;
+    }
+    //Halve the stamps before they wrap, keeping their order
+    if (m_stamp == 0xFF) {
+        m_stamp = m_stamp >> 1;
+        for (uint8_t i = 0; i < m_count; i++) {
+            m_entries[i].stamp = m_entries[i].stamp >> 1;
+        }
+    }
+    m_stamp++;
+    m_entries[entry].stamp = m_stamp;
+    //Same length string, copied over in place
+    if (type == STORE_STRING && m_entries[entry].type == STORE_STRING &&
+        m_entries[entry].value.text.length == length) {
+        memcpy(m_arena + m_entries[entry].value.text.offset, msg, length);
+        return;
+    }
+    release(entry);
+    if (type != STORE_STRING) {
+        m_entries[entry].type = type;
+        m_entries[entry].value = value;
+        return;
+    }
+    //Make room at the end of the arena
+    while ((m_used + length) > STORE_ARENA) {
+        uint8_t victim = oldest(entry, true);
+        if (victim == STORE_NONE) {
+            length = STORE_ARENA - m_used;
+            break;
+        }
+        entry = remove(victim, entry);
+    }
+    memcpy(m_arena + m_used, msg, length);
+    m_entries[entry].type = STORE_STRING;
+    m_entries[entry].value.text.offset = m_used;
+    m_entries[entry].value.text.length = length;
+    m_used += length;
+}
+uint8_t MessageStore::find(uint32_t key) const {
+    return m_index[slot(key)];
+}
+uint8_t MessageStore::count() const {
+    return m_count + 1;
+}
+uint8_t MessageStore::stored() const {
+    return m_count;
+}
+bool MessageStore::get(uint8_t index, char* key, char* msg) const {
+    if (index > m_count) {
+        return false;
+    }
+    if (index == m_count) {
+        strcpy(key, STORE_FIRMWARE_KEY);
+        strncpy(msg, VERSION, MAX_STR_LEN);
+        msg[MAX_STR_LEN] = '\0';
+        return true;
+    }
+    const StoreEntry& entry = m_entries[index];
+    for (uint8_t i = 0; i < MAX_KEY_LEN; i++) {
+        key[i] = static_cast<char>(entry.key >> (8 * i));
+    }
+    key[MAX_KEY_LEN] = '\0';
+    char* end = msg;
+    if (entry.type == STORE_STRING) {
+        memcpy(msg, m_arena + entry.value.text.offset, entry.value.text.length);
+        end += entry.value.text.length;
+    } else if (entry.type == STORE_ADDRESS) {
+        for (uint8_t i = 0; i < 4; i++) {
+            end = digits(end, entry.value.address[i]);
+            *end++ = '.';
+        }
+        end--;
+    } else {
+        if (entry.value.number < 0) {
+            *end++ = '-';
+        }
+        end = digits(end, (entry.value.number < 0) ? -static_cast<uint32_t>(entry.value.number) :
+                                                     static_cast<uint32_t>(entry.value.number));
+    }
+    *end = '\0';
+    return true;
+}
+const StoreEntry& MessageStore::entry(uint8_t index) const {
+    return m_entries[index];
+}
+const char* MessageStore::text(const StoreEntry& entry) const {
+    return m_arena + entry.value.text.offset;
+}
+/**
+ * Linear probing from a fold of the key's bytes. The index always has an
+ * empty slot, ending the probe.
+ */
+uint8_t MessageStore::slot(uint32_t key) const {
+    uint8_t hash = static_cast<uint8_t>(key ^ (key >> 8) ^ (key >> 16) ^ (key >> 24));
+    uint8_t position = (hash ^ (hash >> 4)) & (STORE_INDEX - 1);
+    while (m_index[position] != STORE_NONE && m_entries[m_index[position]].key != key) {
+        position = (position + 1) & (STORE_INDEX - 1);
+    }
+    return position;
+}
+void MessageStore::reindex() {
+    memset(m_index, STORE_NONE, sizeof(m_index));
+    for (uint8_t i = 0; i < m_count; i++) {
+        m_index[slot(m_entries[i].key)] = i;
+    }
+}
+void MessageStore::release(uint8_t entry) {
+    if (m_entries[entry].type != STORE_STRING) {
+        return;
+    }
+    uint8_t offset = m_entries[entry].value.text.offset;
+    uint8_t length = m_entries[entry].value.text.length;
+    memmove(m_arena + offset, m_arena + offset + length, m_used - offset - length);
+    m_used -= length;
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (m_entries[i].type == STORE_STRING && m_entries[i].value.text.offset > offset) {
+            m_entries[i].value.text.offset -= length;
+        }
+    }
+    m_entries[entry].value.text.length = 0;
+}
+uint8_t MessageStore::oldest(uint8_t keep, bool strings) const {
+    uint8_t found = STORE_NONE;
+    for (uint8_t i = 0; i < m_count; i++) {
+        if (i != keep && (!strings || m_entries[i].type == STORE_STRING) &&
+            (found == STORE_NONE || m_entries[i].stamp < m_entries[found].stamp)) {
+            found = i;
+        }
+    }
+    return found;
+}
+uint8_t MessageStore::remove(uint8_t entry, uint8_t keep) {
+    release(entry);
+    m_count--;
+    memmove(m_entries + entry, m_entries + entry + 1, (m_count - entry) * sizeof(StoreEntry));
+    reindex();
+    return (keep != STORE_NONE && keep > entry) ? (keep - 1) : keep;
+}
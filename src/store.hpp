@@ -0,0 +1,191 @@
+/*
+ * store.hpp:
+ *
+ * Store of the messages sent by the host, one per key. A message for a key
+ * already stored updates it in place, so a host refreshing one key does not
+ * push out the others. Once the store is full, a new key replaces the key
+ * least recently updated.
+ *
+ * Keys are packed into a uint32_t, and found through a small open-addressed
+ * hash index. Values are kept compact, by type: an IPv4 address in its four
+ * bytes, an integer as an int32_t, and anything else as a string in a shared,
+ * bounded arena. Strings are kept packed at the start of the arena. A string
+ * of the same length is copied over in place; otherwise it is cut out, the
+ * strings above closed up, and the new one appended. A string that does not
+ * fit pushes out the strings least recently updated. Values are only typed
+ * when they print back exactly as sent, so every message reads back as it
+ * came in.
+ *
+ * Messages are listed in the order their keys arrived, followed by the
+ * firmware version under key "FIRM", which is rendered rather than stored.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_STORE_HPP_
+#define SRC_STORE_HPP_
+#include "types.hpp"
+//!< Keys stored
+#define STORE_ENTRIES MAX_MSG_COUNT
+//!< Hash index slots, a power of two above the keys stored
+#define STORE_INDEX 16
+//!< Bytes of string values stored
+#define STORE_ARENA 192
+//!< Empty index slot, or no entry
+#define STORE_NONE 0xFF
+//!< Key listed after the stored messages, and its message
+#define STORE_FIRMWARE_KEY "FIRM"
+
+/**
+ * StoreType:
+ *
+ * How an entry's value is kept.
+ */
+enum StoreType {
+    STORE_STRING,  //!< String in the arena
+    STORE_ADDRESS, //!< Dotted IPv4 address, as its four bytes
+    STORE_NUMBER,  //!< Decimal integer, as an int32_t
+};
+/**
+ * StoreValue:
+ *
+ * A value, as kept for its type.
+ */
+union StoreValue {
+    int32_t number;      //!< STORE_NUMBER value
+    uint8_t address[4];  //!< STORE_ADDRESS value
+    struct {
+        uint8_t offset;  //!< Start in the arena
+        uint8_t length;  //!< Length, without a terminator
+    } text;              //!< STORE_STRING value
+};
+/**
+ * StoreEntry:
+ *
+ * A key and its typed value.
+ */
+struct StoreEntry {
+    uint32_t key;     //!< Packed key
+    uint8_t type;     //!< StoreType of the value
+    uint8_t stamp;    //!< Store stamp at the last update
+    StoreValue value; //!< Value
+};
+
+class MessageStore {
+    public:
+        /**
+         * Construct an empty store.
+         */
+        MessageStore();
+        /**
+         * Pack a key, up to its terminator or MAX_KEY_LEN characters.
+         * \param const char* key: key to pack
+         * \return packed key
+         */
+        static uint32_t pack(const char* key);
+        /**
+         * Store the message for a key, replacing its last one.
+         * \param const char* key: key of the message
+         * \param const char* msg: message, up to MAX_STR_LEN characters
+         */
+        void set(const char* key, const char* msg);
+        /**
+         * Store the message for a key from a counted string, which need not
+         * be terminated.
+         * \param const char* key: key of the message
+         * \param const char* msg: message
+         * \param uint8_t length: length of the message, up to MAX_STR_LEN
+         */
+        void set(const char* key, const char* msg, uint8_t length);
+        /**
+         * Store a value already typed for a key.
+         * \param const char* key: key of the value
+         * \param StoreType type: STORE_ADDRESS or STORE_NUMBER
+         * \param const StoreValue& value: value
+         */
+        void set(const char* key, StoreType type, const StoreValue& value);
+        /**
+         * Find the entry of a key.
+         * \param uint32_t key: packed key
+         * \return index of its entry, or STORE_NONE
+         */
+        uint8_t find(uint32_t key) const;
+        /**
+         * Count of messages listed, the firmware version included.
+         */
+        uint8_t count() const;
+        /**
+         * Count of messages sent by the host.
+         */
+        uint8_t stored() const;
+        /**
+         * Print a listed message as text.
+         * \param uint8_t index: message, below count
+         * \param char* key: filled with the key, MAX_KEY_LEN + 1 long
+         * \param char* msg: filled with the message, MAX_STR_LEN + 1 long
+         * \return true if printed, false if there is no such message
+         */
+        bool get(uint8_t index, char* key, char* msg) const;
+        /**
+         * Entry of a message sent by the host, as kept.
+         * \param uint8_t index: message, below stored
+         * \return entry
+         */
+        const StoreEntry& entry(uint8_t index) const;
+        /**
+         * String of an entry holding one, not terminated.
+         * \param const StoreEntry& entry: STORE_STRING entry
+         * \return start of the string, its length in the entry
+         */
+        const char* text(const StoreEntry& entry) const;
+    private:
+        /**
+         * Store a value for a key, the entry made if it is new.
+         * \param uint32_t key: packed key
+         * \param StoreType type: type of the value
+         * \param const StoreValue& value: value, for types other than strings
+         * \param const char* msg: string, for STORE_STRING
+         * \param uint8_t length: length of the string
+         */
+        void update(uint32_t key, StoreType type, const StoreValue& value,
+                    const char* msg, uint8_t length);
+        /**
+         * Index slot of a key, or the empty slot it would take.
+         * \param uint32_t key: packed key
+         */
+        uint8_t slot(uint32_t key) const;
+        /**
+         * Rebuild the hash index from the entries.
+         */
+        void reindex();
+        /**
+         * Cut an entry's string out of the arena, closing up the ones above.
+         * \param uint8_t entry: entry, left with an empty string
+         */
+        void release(uint8_t entry);
+        /**
+         * Entry least recently updated.
+         * \param uint8_t keep: entry not to pick
+         * \param bool strings: only pick entries holding strings
+         * \return entry, or STORE_NONE if there is none to pick
+         */
+        uint8_t oldest(uint8_t keep, bool strings) const;
+        /**
+         * Remove an entry, keeping the rest in order.
+         * \param uint8_t entry: entry to remove
+         * \param uint8_t keep: another entry to track
+         * \return index of keep once the entries have closed up
+         */
+        uint8_t remove(uint8_t entry, uint8_t keep);
+        //!< Entries, in the order their keys arrived
+        StoreEntry m_entries[STORE_ENTRIES];
+        //!< Hash index of entries by key
+        uint8_t m_index[STORE_INDEX];
+        //!< String values, packed from the start
+        char m_arena[STORE_ARENA];
+        //!< Entries stored, arena bytes used, and the stamp of the last update
+        uint8_t m_count;
+        uint8_t m_used;
+        uint8_t m_stamp;
+};
+#endif /* SRC_STORE_HPP_ */
@@ -0,0 +1,58 @@
+/*
+ * ticker.cpp:
+ *
+ * Timer tick implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include "ticker.hpp"
+//!< Microseconds per millisecond
+#define TICKER_US_PER_MS 1000
+//Concrete definitions
+TickHandle Ticker::s_handlers[TICKER_MAX_HANDLERS];
+volatile uint8_t Ticker::s_count = 0;
+uint16_t Ticker::s_us = 0;
+/**
+ * Timer interrupt handler
+ */
+void ticker_isr() {
+    Ticker::tick();
+}
+#ifdef ARDUINO
+ISR(TIMER2_OVF_vect, ISR_NOBLOCK) {
+    ticker_isr();
+}
+#endif
+/**
+ * The handler is in place before the count lets the interrupt see it
+ */
+bool Ticker::attach(TickHandle handler) {
+    if (s_count >= TICKER_MAX_HANDLERS) {
+        return false;
+    }
+    s_handlers[s_count] = handler;
+    s_count = s_count + 1;
+    if (s_count == 1) {
+#ifdef ARDUINO
+        TIMSK2 |= _BV(TOIE2);
+#else
+        attachTimer(TICKER_PERIOD_US, ticker_isr);
+#endif
+    }
+    return true;
+}
+/**
+ * Two or three milliseconds a tick, the odd microseconds carried
+ */
+void Ticker::tick() {
+    s_us += TICKER_PERIOD_US;
+    uint8_t ms = 0;
+    while (s_us >= TICKER_US_PER_MS) {
+        s_us -= TICKER_US_PER_MS;
+        ms++;
+    }
+    for (uint8_t i = 0; i < s_count; i++) {
+        s_handlers[i](ms);
+    }
+}
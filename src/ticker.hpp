@@ -0,0 +1,50 @@
+/*
+ * ticker.hpp:
+ *
+ * Millisecond ticks from a hardware timer interrupt, for work that must keep
+ * time regardless of the rate group, such as LED animation. Timer2 already
+ * runs for PWM on pins 3 and 11 (phase correct, prescaler 64), overflowing
+ * every 2040us, so its overflow interrupt costs no timer and leaves the PWM
+ * as it is. Each overflow hands the whole milliseconds passed to the
+ * handlers, carrying the remainder.
+ *
+ * Handlers run in interrupt context, and must be fast. The interrupt runs
+ * with interrupts enabled, such that the soft UART's Timer1 ticks and the
+ * other receive interrupts preempt the handlers rather than wait on them. A
+ * tick is far shorter than the overflow period, so it never nests in itself.
+ * On the native build the simulator's timer interrupt stands in for Timer2.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_TICKER_HPP_
+#define SRC_TICKER_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Time between Timer2 overflows: 510 timer counts of 64 cycles at 16MHz
+#define TICKER_PERIOD_US 2040
+//!< Most handlers
+#define TICKER_MAX_HANDLERS 2
+//!< Handler called with the milliseconds passed since its last call
+typedef void (*TickHandle)(uint8_t ms);
+
+class Ticker {
+    public:
+        /**
+         * Add a handler, starting the ticks with the first one.
+         * \param TickHandle handler: handler to call from the interrupt
+         * \return true if added, false if there is no room
+         */
+        static bool attach(TickHandle handler);
+        /**
+         * Timer overflow handler. Called from the timer interrupt.
+         */
+        static void tick();
+    private:
+        //!< Handlers called each tick
+        static TickHandle s_handlers[TICKER_MAX_HANDLERS];
+        static volatile uint8_t s_count;
+        //!< Microseconds passed, not yet handed out
+        static uint16_t s_us;
+};
+#endif /* SRC_TICKER_HPP_ */
@@ -0,0 +1,82 @@
+/*
+ * timing.cpp:
+ *
+ * Timing statistics implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <string.h>
+#include "timing.hpp"
+/**
+ * Start empty.
+ */
+Timing::Timing() {
+    clear();
+}
+/**
+ * Clear back to the empty state. Minimum starts high so the first record wins.
+ */
+void Timing::clear() {
+    m_min = 0xFFFF;
+    m_max = 0;
+    m_total = 0;
+    m_count = 0;
+    memset(m_hist, 0, sizeof(m_hist));
+}
+/**
+ * Halve the accumulators, such that long runs keep a meaningful mean.
+ */
+void Timing::decay() {
+    m_total = m_total >> 1;
+    m_count = m_count >> 1;
+    for (unsigned int i = 0; i < TIMING_BUCKETS; i++) {
+        m_hist[i] = m_hist[i] >> 1;
+    }
+}
+/**
+ * Record a duration, saturating at the longest representable duration.
+ */
+void Timing::record(uint32_t us) {
+    uint32_t ticks = us / TIMING_TICK_US;
+    uint16_t value = (ticks > 0xFFFF) ? 0xFFFF : static_cast<uint16_t>(ticks);
+    //Keep headroom in all accumulators
+    if (m_count == 0xFFFF || (m_total + value) < m_total) {
+        decay();
+    }
+    m_min = (value < m_min) ? value : m_min;
+    m_max = (value > m_max) ? value : m_max;
+    m_total += value;
+    m_count++;
+    //Find the bucket, each four times wider than the last
+    unsigned int bucket = 0;
+    uint32_t bound = TIMING_BUCKET_BASE_US / TIMING_TICK_US;
+    while (value >= bound && bucket < (TIMING_BUCKETS - 1)) {
+        bound = bound << 2;
+        bucket++;
+    }
+    if (m_hist[bucket] != 0xFFFF) {
+        m_hist[bucket]++;
+    }
+}
+/**
+ * Print the statistics. An empty record prints zeros.
+ */
+void Timing::report(Print& out) const {
+    uint32_t mean = (m_count == 0) ? 0 : (m_total / m_count);
+    out.print(F("n="));
+    out.print(m_count);
+    out.print(F(" min="));
+    out.print((m_count == 0) ? 0UL : static_cast<uint32_t>(m_min) * TIMING_TICK_US);
+    out.print(F(" max="));
+    out.print(static_cast<uint32_t>(m_max) * TIMING_TICK_US);
+    out.print(F(" avg="));
+    out.print(mean * TIMING_TICK_US);
+    out.print(F(" h="));
+    for (unsigned int i = 0; i < TIMING_BUCKETS; i++) {
+        if (i != 0) {
+            out.print(',');
+        }
+        out.print(m_hist[i]);
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ * timing.hpp:
+ *
+ * Execution-time statistics. A Timing records durations measured with
+ * micros() and keeps the minimum, maximum, mean, and a small fixed-bucket
+ * histogram of them. Durations are stored in micros() ticks, which are 4us on
+ * a 16MHz Nano, to keep each record small. Buckets grow by a factor of four
+ * starting from TIMING_BUCKET_BASE_US.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_TIMING_HPP_
+#define SRC_TIMING_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Resolution of micros() in microseconds
+#define TIMING_TICK_US 4
+//!< Number of histogram buckets
+#define TIMING_BUCKETS 6
+//!< Upper bound of the first histogram bucket in microseconds
+#define TIMING_BUCKET_BASE_US 32
+
+class Timing {
+    public:
+        /**
+         * Construct an empty timing record.
+         */
+        Timing();
+        /**
+         * Record one measured duration.
+         * \param uint32_t us: duration in microseconds
+         */
+        void record(uint32_t us);
+        /**
+         * Clear all recorded durations.
+         */
+        void clear();
+        /**
+         * Print the statistics as space separated "name=value" fields. All
+         * times are in microseconds.
+         * \param Print& out: output to print to
+         */
+        void report(Print& out) const;
+    private:
+        /**
+         * Halve all accumulated counts, keeping the mean and histogram shape
+         * when a counter would otherwise overflow.
+         */
+        void decay();
+        //!< Shortest duration in ticks
+        uint16_t m_min;
+        //!< Longest duration in ticks
+        uint16_t m_max;
+        //!< Sum of durations in ticks, for the mean
+        uint32_t m_total;
+        //!< Number of recorded durations in m_total
+        uint16_t m_count;
+        //!< Histogram of durations
+        uint16_t m_hist[TIMING_BUCKETS];
+};
+#endif /* SRC_TIMING_HPP_ */
@@ -0,0 +1,176 @@
+/*
+ * twi.cpp:
+ *
+ * Interrupt-driven I2C master implementations.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <string.h>
+#include "twi.hpp"
+#ifdef ARDUINO
+#include <util/twi.h>
+#include "pin.hpp"
+//!< Control register values: carry on, start, and stop then start again
+#define TWI_CONTINUE (_BV(TWINT) | _BV(TWEN) | _BV(TWIE))
+#define TWI_START (TWI_CONTINUE | _BV(TWSTA))
+#define TWI_RESTART (TWI_CONTINUE | _BV(TWSTO) | _BV(TWSTA))
+//!< Stop, leaving the interrupt off
+#define TWI_STOP (_BV(TWINT) | _BV(TWEN) | _BV(TWSTO))
+//!< Bus pins: SDA on A4, SCL on A5
+#define TWI_SDA_PIN 18
+#define TWI_SCL_PIN 19
+#else
+//!< Microseconds between polls while flushing
+#define TWI_POLL_US 100
+#endif
+//!< Queue index mask
+#define TWI_MASK (TWI_QUEUE - 1)
+//Concrete definitions
+TwiTransfer Twi::s_queue[TWI_QUEUE];
+volatile uint8_t Twi::s_head = 0;
+volatile uint8_t Twi::s_tail = 0;
+volatile bool Twi::s_busy = false;
+uint8_t Twi::s_index = 0;
+volatile uint16_t Twi::s_errors = 0;
+/**
+ * TWI interrupt handler
+ */
+void twi_isr() {
+    Twi::interrupt();
+}
+#ifdef ARDUINO
+ISR(TWI_vect) {
+    twi_isr();
+}
+#endif
+/**
+ * SCL is F_CPU / (16 + 2 * TWBR) with no prescale. The internal pull-ups back
+ * the bus up, as Wire sets them.
+ */
+void Twi::begin(uint32_t clock) {
+#ifdef ARDUINO
+    Pin<TWI_SDA_PIN>::input_pullup();
+    Pin<TWI_SCL_PIN>::input_pullup();
+    TWSR = 0;
+    TWBR = ((F_CPU / clock) - 16) / 2;
+    TWCR = _BV(TWEN);
+#else
+    attachI2c(clock, twi_isr);
+#endif
+}
+/**
+ * The descriptor is filled in before the tail lets the interrupt see it
+ */
+bool Twi::send(uint8_t address, uint8_t control, const uint8_t* data, uint8_t length) {
+    if (static_cast<uint8_t>(s_tail - s_head) >= TWI_QUEUE) {
+        return false;
+    }
+    TwiTransfer& transfer = s_queue[s_tail & TWI_MASK];
+    transfer.address = address;
+    transfer.control = control;
+    transfer.data = data;
+    transfer.length = length;
+    noInterrupts();
+    s_tail = s_tail + 1;
+    if (!s_busy) {
+        s_busy = true;
+        start();
+    }
+    interrupts();
+    return true;
+}
+
+bool Twi::idle() {
+    return !s_busy;
+}
+
+void Twi::flush() {
+    while (!idle()) {
+#ifndef ARDUINO
+        delayMicroseconds(TWI_POLL_US);
+#endif
+    }
+}
+
+uint16_t Twi::errors() {
+    noInterrupts();
+    uint16_t errors = s_errors;
+    interrupts();
+    return errors;
+}
+#ifdef ARDUINO
+void Twi::start() {
+    s_index = 0;
+    TWCR = TWI_START;
+}
+/**
+ * Each interrupt follows one bus step: a start sends the address, and each
+ * acknowledged byte sends the next, the control byte first. Anything else
+ * is a refusal or a lost bus, and drops the transmission.
+ */
+void Twi::interrupt() {
+    const TwiTransfer& transfer = s_queue[s_head & TWI_MASK];
+    switch (TW_STATUS) {
+        case TW_START:
+        case TW_REP_START:
+            TWDR = (transfer.address << 1) | TW_WRITE;
+            TWCR = TWI_CONTINUE;
+            break;
+        case TW_MT_SLA_ACK:
+        case TW_MT_DATA_ACK:
+            if (s_index > transfer.length) {
+                finish();
+                break;
+            }
+            TWDR = (s_index == 0) ? transfer.control : transfer.data[s_index - 1];
+            s_index++;
+            TWCR = TWI_CONTINUE;
+            break;
+        default:
+            s_errors = s_errors + 1;
+            finish();
+            break;
+    }
+}
+/**
+ * The stop and the next start go out together
+ */
+void Twi::finish() {
+    s_head = s_head + 1;
+    if (s_head != s_tail) {
+        s_index = 0;
+        TWCR = TWI_RESTART;
+    } else {
+        TWCR = TWI_STOP;
+        s_busy = false;
+    }
+}
+#else
+/**
+ * The simulated bus sends a whole transmission, then interrupts
+ */
+void Twi::start() {
+    const TwiTransfer& transfer = s_queue[s_head & TWI_MASK];
+    uint8_t bytes[1 + UINT8_MAX];
+    bytes[0] = transfer.control;
+    memcpy(bytes + 1, transfer.data, transfer.length);
+    i2cTransmit(transfer.address, bytes, transfer.length + 1);
+}
+
+void Twi::interrupt() {
+    if (i2cStatus() != 0) {
+        s_errors = s_errors + 1;
+    }
+    finish();
+}
+
+void Twi::finish() {
+    s_head = s_head + 1;
+    if (s_head != s_tail) {
+        start();
+    } else {
+        s_busy = false;
+    }
+}
+#endif
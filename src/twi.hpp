@@ -0,0 +1,91 @@
+/*
+ * twi.hpp:
+ *
+ * Interrupt-driven I2C (TWI) master transmitter. Transmissions are queued as
+ * descriptors, and the TWI interrupt clocks each one out in the background:
+ * start, address, a leading control byte, the data, then stop, or a repeated
+ * start straight into the next queued transmission. The CPU only spends the
+ * few instructions of each byte's interrupt, so the serial passthrough keeps
+ * running while, for example, the OLED panel updates.
+ *
+ * Data is read as it is sent, and must stay put until the engine is idle.
+ * Transmissions the device does not acknowledge are dropped and counted.
+ *
+ * This replaces the Wire library, whose TWI interrupt it would clash with.
+ * On the native build the simulator's I2C bus stands in for the TWI.
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#ifndef SRC_TWI_HPP_
+#define SRC_TWI_HPP_
+#include "hal.hpp"
+#include "types.hpp"
+//!< Transmissions queued at once, must be a power of two
+#define TWI_QUEUE 4
+
+/**
+ * TwiTransfer:
+ *
+ * One queued transmission.
+ */
+struct TwiTransfer {
+    uint8_t address;     //!< 7-bit device address
+    uint8_t control;     //!< Byte sent before the data, as a control or register byte
+    const uint8_t* data; //!< Data, read as it is sent
+    uint8_t length;      //!< Data bytes
+};
+
+class Twi {
+    public:
+        /**
+         * Set up the TWI as bus master at the clock, with the bus pulled up.
+         * \param uint32_t clock: bus clock in Hz
+         */
+        static void begin(uint32_t clock);
+        /**
+         * Queue a transmission, starting the engine if idle.
+         * \param uint8_t address: 7-bit device address
+         * \param uint8_t control: byte sent before the data
+         * \param const uint8_t* data: data, left untouched until idle
+         * \param uint8_t length: data bytes
+         * \return true if queued, false if the queue is full
+         */
+        static bool send(uint8_t address, uint8_t control, const uint8_t* data, uint8_t length);
+        /**
+         * Are all queued transmissions sent.
+         */
+        static bool idle();
+        /**
+         * Wait until all queued transmissions are sent. Only for set up.
+         */
+        static void flush();
+        /**
+         * Transmissions dropped as not acknowledged, or lost on the bus.
+         */
+        static uint16_t errors();
+        /**
+         * Move the engine on. Called from the TWI interrupt.
+         */
+        static void interrupt();
+    private:
+        /**
+         * Start the transmission at the head of the queue.
+         */
+        static void start();
+        /**
+         * Retire the head transmission, starting the next if any.
+         */
+        static void finish();
+        //!< Queued transmissions. Head and tail count freely, and are masked.
+        static TwiTransfer s_queue[TWI_QUEUE];
+        static volatile uint8_t s_head;
+        static volatile uint8_t s_tail;
+        //!< A transmission is on the bus
+        static volatile bool s_busy;
+        //!< Next byte of the head transmission: 0 for its control byte
+        static uint8_t s_index;
+        //!< Dropped transmissions
+        static volatile uint16_t s_errors;
+};
+#endif /* SRC_TWI_HPP_ */
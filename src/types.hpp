@@ -15,13 +15,13 @@
 //!< Maximum key width
 #define MAX_KEY_LEN 4
 //!< Maximum length of string
-#define MAX_STR_LEN 20
+#define MAX_STR_LEN 40
 //!< Seconds per millisecond
 #define MS_PER_SECOND 1000
 //!< Maximum gpio pin count
 #define GPIO_PIN_COUNT 32
-//!< Maximum message count
-#define MAX_MSG_COUNT 5
+//!< Maximum message count, in distinct keys
+#define MAX_MSG_COUNT 12
 //!< Get array elements
 #define NUM_ARRAY_ELEMENTS(array) (sizeof(array)/sizeof(array[0]))
 //!< Runner count
@@ -31,6 +31,8 @@
 typedef float float32;
 //!< Sized 64bit floatin point
 typedef double float64;
+//!< Serial receiver called as each byte arrives, returns true to take the byte
+typedef bool (*SerialReceiver)(uint8_t byte);
 
 /**
  * ButtonType:
@@ -55,18 +57,6 @@ enum SerialType {
     SERIAL_MATRIX, //!< Serial connected to the matrix switch
     MAX_SERIAL //!< Helper for bounds checking
 };
-/**
- * BootStatus:
- *
- * Current state of the host computers boot. Used to communicate where in the
- * boot process the host computer is at.
- */
-enum BootStatus {
-    BOOT_ON, //!< Host system is on
-    BOOT_OFF, //!< Host system is off
-    BOOT_STARTUP, //!< Host system is starting up
-    MAX_BOOT //!< Helper for bounds checking
-};
 /**
  * Function for handling errors. Will be called from the above error handling
  * function.
@@ -0,0 +1,184 @@
+/*
+ * test_journal.cpp:
+ *
+ * Tests of the warm-start journal against the simulator's EEPROM. A writer
+ * journal runs on the schedule, as in the firmware, and a reader journal
+ * restores from the EEPROM it leaves, as the firmware does after a reset:
+ *
+ * 1. Early change: a change made soon after boot is written once it settles,
+ *    not held back for the interval.
+ * 2. Ring wrap: snapshots written round the ring several times each restore
+ *    as the latest, and the ring wears evenly.
+ * 3. Torn writes: a snapshot cut short after each of its EEPROM writes, up to
+ *    but not including its commit, restores the snapshot before it, over a
+ *    ring left full of older snapshots.
+ *
+ * Run with: platformio test -e native
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: lestarch
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+#include "hal.hpp"
+#include "types.hpp"
+#include "runner.hpp"
+#include "serial.hpp"
+#include "oled.hpp"
+#include "indicator.hpp"
+#include "journal.hpp"
+//!< Key of the message the tests change
+#define TEST_KEY "HELO"
+//!< Longest virtual time to wait on a snapshot
+#define TEST_TIMEOUT_MS (2 * JOURNAL_INTERVAL_MS)
+//!< Laps of the ring written by the wrap test
+#define TEST_LAPS 3
+
+static MatrixSerial s_soft(3, 6);
+static SerialPass s_pass(Serial, s_soft);
+static OLED s_oled;
+static Journal s_writer(s_pass, s_oled);
+
+/**
+ * EEPROM byte writes so far
+ */
+static uint32_t writes() {
+    return Sim::eeprom_writes(E2END + 1);
+}
+/**
+ * Run the schedule until the EEPROM has taken a count of writes more, or the
+ * timeout. Returns the writes taken.
+ */
+static uint32_t run_writes(uint32_t count) {
+    uint32_t start = writes();
+    uint32_t begin = millis();
+    while ((writes() - start) < count && (millis() - begin) < TEST_TIMEOUT_MS) {
+        Runner::cycle();
+    }
+    return writes() - start;
+}
+/**
+ * Run the schedule until a snapshot is committed: its writes start, and then
+ * stop for a settle time. Returns its writes.
+ */
+static uint32_t run_snapshot() {
+    uint32_t start = writes();
+    run_writes(1);
+    uint32_t last = writes();
+    uint32_t quiet = millis();
+    while ((millis() - quiet) < JOURNAL_SETTLE_MS) {
+        Runner::cycle();
+        if (writes() != last) {
+            last = writes();
+            quiet = millis();
+        }
+    }
+    return writes() - start;
+}
+/**
+ * Message of the test key restored by a journal reading the EEPROM, as after
+ * a reset. The message is lost from the store first, and put back after, so
+ * the writer carries on as it was.
+ */
+static const char* restored() {
+    static char found[MAX_STR_LEN + 1];
+    char current[MAX_STR_LEN + 1] = "";
+    char key[MAX_KEY_LEN + 1];
+    char msg[MAX_STR_LEN + 1];
+    for (uint8_t i = 0; Indicator::store().get(i, key, msg); i++) {
+        if (strcmp(key, TEST_KEY) == 0) {
+            strcpy(current, msg);
+        }
+    }
+    Indicator::message(TEST_KEY, "lost");
+    Journal reader(s_pass, s_oled);
+    reader.restore();
+    for (uint8_t i = 0; Indicator::store().get(i, key, msg); i++) {
+        if (strcmp(key, TEST_KEY) == 0) {
+            strcpy(found, msg);
+        }
+    }
+    Indicator::message(TEST_KEY, current);
+    return found;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/**
+ * The writer has just restored, as at boot. Its change is written within a
+ * settle time and a snapshot's writes, far inside the interval.
+ */
+void test_early_change() {
+    uint32_t begin = millis();
+    Indicator::message(TEST_KEY, "early");
+    TEST_ASSERT_NOT_EQUAL(0, run_snapshot());
+    TEST_ASSERT_TRUE((millis() - begin) < (4 * JOURNAL_SETTLE_MS));
+    TEST_ASSERT_EQUAL_STRING("early", restored());
+}
+/**
+ * Each snapshot is cut short after one more of its writes than the last, and
+ * then left to finish
+ */
+void test_torn_write() {
+    char msg[MAX_STR_LEN + 1];
+    char last[MAX_STR_LEN + 1] = "snap";
+    Indicator::message(TEST_KEY, last);
+    uint32_t total = run_snapshot();
+    TEST_ASSERT_TRUE(total > (JOURNAL_HEADER + JOURNAL_TRAILER + 1));
+    TEST_ASSERT_EQUAL_STRING(last, restored());
+    for (uint32_t cut = 1; cut < total; cut++) {
+        snprintf(msg, sizeof(msg), "%04u", static_cast<unsigned int>(cut));
+        Indicator::message(TEST_KEY, msg);
+        TEST_ASSERT_EQUAL_UINT32(cut, run_writes(cut));
+        TEST_ASSERT_EQUAL_STRING(last, restored());
+        TEST_ASSERT_EQUAL_UINT32(total - cut, run_snapshot());
+        TEST_ASSERT_EQUAL_STRING(msg, restored());
+        strcpy(last, msg);
+    }
+}
+/**
+ * Each snapshot is taken as it is committed, and the last restored once the
+ * state is lost. The ring's bytes are each written about once a lap.
+ */
+void test_ring_wrap() {
+    char msg[MAX_STR_LEN + 1];
+    uint32_t start = writes();
+    uint32_t laps = 0;
+    for (uint32_t i = 0; (writes() - start) < (TEST_LAPS * JOURNAL_SIZE); i++, laps++) {
+        snprintf(msg, sizeof(msg), "%04u", static_cast<unsigned int>(i));
+        Indicator::message(TEST_KEY, msg);
+        TEST_ASSERT_NOT_EQUAL(0, run_snapshot());
+        TEST_ASSERT_EQUAL_STRING(msg, restored());
+    }
+    TEST_ASSERT_TRUE(laps > TEST_LAPS);
+    uint32_t least = 0xFFFFFFFF;
+    uint32_t most = 0;
+    for (uint16_t address = 0; address < JOURNAL_SIZE; address++) {
+        uint32_t count = Sim::eeprom_writes(address);
+        least = (count < least) ? count : least;
+        most = (count > most) ? count : most;
+    }
+    TEST_ASSERT_TRUE(least > 0);
+    TEST_ASSERT_TRUE(most <= 2 * (least + 2));
+}
+
+/**
+ * The EEPROM starts erased, and the writer restores from it, then runs on the
+ * schedule as in setup
+ */
+int main(int argc, char** argv) {
+    for (uint16_t address = 0; address <= E2END; address++) {
+        eeprom_write_byte(reinterpret_cast<uint8_t*>(address), 0xFF);
+    }
+    s_writer.restore();
+    Runner* runners[] = {&s_writer};
+    Runner::register_runners(runners, NUM_ARRAY_ELEMENTS(runners));
+    Runner::start();
+    UNITY_BEGIN();
+    RUN_TEST(test_early_change);
+    RUN_TEST(test_ring_wrap);
+    RUN_TEST(test_torn_write);
+    return UNITY_END();
+}